@@ -6,7 +6,53 @@
 #include <sstream>
 #include <regex>
 #include <limits>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <algorithm>
+#include <memory>
+#include <atomic>
+#include <mutex>
+#include <chrono>
+#include <functional>
+#include <array>
+#include <cstring>
+#include <cstddef>
+#include <string_view>
+#include <charconv>
+#include <random>
+#include <system_error>
+#include <condition_variable>
+#include <deque>
+#include <optional>
+#include <tuple>
+#include <new>
+#ifdef _WIN32
+#define NOMINMAX
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include <io.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+#ifdef __linux__
+#include <csignal>
+#include <cerrno>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/resource.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#endif
 using namespace std;
+namespace fs = std::filesystem;
 
 // ==== ENUMS ====
 enum OrderStatus {
@@ -14,7 +60,8 @@ enum OrderStatus {
     Preparing,
     Cooking,
     Packed,
-    Ready
+    Ready,
+    Cancelled // yalnız Received-dən; ehtiyat geri qaytarılır
 };
 
 enum Gender {
@@ -22,6 +69,816 @@ enum Gender {
     Female
 };
 
+// ==== STATS ====
+// Latency histograms and counters for the hot paths. Every thread records
+// into its own block with relaxed atomic loads and stores (one writer per
+// block), so recording takes no lock and never contends; report() merges the
+// blocks. Histograms are log-linear like HDR histograms: 16 sub-buckets per
+// power of two of nanoseconds, so percentiles are within about 6%.
+// Built with FINALPROJECT_NO_STATS (CMake: -DFINALPROJECT_STATS=OFF),
+// STATS_TIME and STATS_COUNT expand to nothing.
+enum StatOp {
+    StatFileRewrite,    // writeFileAtomically
+    StatFileAppend,     // appendToFile
+    StatJournalFlush,
+    StatFlushRound,     // one Persister round
+    StatUserParse,      // User.txt row -> validated User
+    StatSignIn,
+    StatCreateOrder,
+    StatMoveForward,
+    StatAdvanceOrders,
+    StatServerRequest,
+    StatOpCount
+};
+
+enum StatCounter {
+    CounterBytesWritten,
+    CounterRecordsParsed,   // text lines read and snapshot records mapped
+    CounterCount
+};
+
+#ifndef FINALPROJECT_NO_STATS
+class Stats {
+    static constexpr int subBits = 4;
+    static constexpr int bucketCount = (64 - subBits + 1) << subBits;
+
+    struct Block {
+        atomic<uint64_t> histogram[StatOpCount][bucketCount];
+        atomic<uint64_t> totalNs[StatOpCount];
+        atomic<uint64_t> maxNs[StatOpCount];
+        atomic<uint64_t> counters[CounterCount];
+    };
+
+    // Numbers of the threads that have finished; always the first block.
+    static Block& retired() {
+        static Block b;
+        return b;
+    }
+
+    static vector<Block*>& blocks() {
+        static vector<Block*> all{ &retired() };
+        return all;
+    }
+
+    static mutex& blocksMutex() {
+        static mutex m;
+        return m;
+    }
+
+    // Owns the thread's block. When the thread ends, the block is folded into
+    // retired() and freed, so threads that come and go (engine workers and
+    // writers, shard threads) do not keep adding blocks.
+    struct Holder {
+        Block* block = nullptr;
+        ~Holder() {
+            if (!block) return;
+            lock_guard<mutex> lock(blocksMutex());
+            merge(retired(), *block);
+            vector<Block*>& all = blocks();
+            all.erase(find(all.begin(), all.end(), block));
+            delete block;
+        }
+    };
+
+    static Block& local() {
+        thread_local Holder holder;
+        if (!holder.block) {
+            holder.block = new Block(); // sıfırlanmış
+            lock_guard<mutex> lock(blocksMutex());
+            blocks().push_back(holder.block);
+        }
+        return *holder.block;
+    }
+
+    static void bump(atomic<uint64_t>& cell, uint64_t n) noexcept {
+        cell.store(cell.load(memory_order_relaxed) + n, memory_order_relaxed);
+    }
+
+    // Called with blocksMutex held; `into` has no other writer then.
+    static void merge(Block& into, const Block& from) noexcept {
+        for (int op = 0; op < StatOpCount; op++) {
+            for (int i = 0; i < bucketCount; i++)
+                bump(into.histogram[op][i], from.histogram[op][i].load(memory_order_relaxed));
+            bump(into.totalNs[op], from.totalNs[op].load(memory_order_relaxed));
+            uint64_t maxNs = from.maxNs[op].load(memory_order_relaxed);
+            if (maxNs > into.maxNs[op].load(memory_order_relaxed)) into.maxNs[op].store(maxNs, memory_order_relaxed);
+        }
+        for (int c = 0; c < CounterCount; c++)
+            bump(into.counters[c], from.counters[c].load(memory_order_relaxed));
+    }
+
+    static int highBit(uint64_t v) noexcept {
+#if defined(__GNUC__) || defined(__clang__)
+        return 63 - __builtin_clzll(v);
+#else
+        int bit = 0;
+        while (v >>= 1) bit++;
+        return bit;
+#endif
+    }
+
+    static int bucketOf(uint64_t ns) noexcept {
+        if (ns < (1u << subBits)) return (int)ns;
+        int e = highBit(ns);
+        return ((e - subBits + 1) << subBits) | (int)((ns >> (e - subBits)) & ((1u << subBits) - 1));
+    }
+
+    // Middle of the bucket's value range.
+    static double bucketValue(int bucket) noexcept {
+        if (bucket < (1 << subBits)) return bucket;
+        int e = (bucket >> subBits) + subBits - 1;
+        double low = (double)(((1u << subBits) | (bucket & ((1u << subBits) - 1)))) * (double)(1ull << (e - subBits));
+        return low + (double)(1ull << (e - subBits)) / 2;
+    }
+
+    // A bucket's middle can lie above the largest sample, hence the clamp.
+    static double percentile(const vector<uint64_t>& histogram, uint64_t count, uint64_t maxNs, double p) {
+        uint64_t rank = max<uint64_t>(1, (uint64_t)ceil(p * count)), seen = 0;
+        for (int b = 0; b < bucketCount; b++)
+            if ((seen += histogram[b]) >= rank) return min(bucketValue(b), (double)maxNs);
+        return (double)maxNs;
+    }
+public:
+    static constexpr bool enabled = true;
+
+    static const char* opName(StatOp op) {
+        static const char* names[StatOpCount] = { "file_rewrite", "file_append", "journal_flush", "flush_round",
+            "user_parse", "sign_in", "create_order", "move_forward", "advance_orders", "server_request" };
+        return names[op];
+    }
+
+    static void record(StatOp op, uint64_t ns) noexcept {
+        Block& b = local();
+        bump(b.histogram[op][bucketOf(ns)], 1);
+        bump(b.totalNs[op], ns);
+        if (ns > b.maxNs[op].load(memory_order_relaxed)) b.maxNs[op].store(ns, memory_order_relaxed);
+    }
+
+    static void add(StatCounter counter, uint64_t n) noexcept { bump(local().counters[counter], n); }
+
+    // Current percentiles of every operation seen so far, and the counters.
+    static string report() {
+        vector<uint64_t> histogram(bucketCount);
+        string text = "operation          count    mean us     p50 us     p99 us    p999 us     max us\n";
+        lock_guard<mutex> lock(blocksMutex());
+        for (int op = 0; op < StatOpCount; op++) {
+            fill(histogram.begin(), histogram.end(), 0);
+            uint64_t count = 0, totalNs = 0, maxNs = 0;
+            for (Block* b : blocks()) {
+                for (int i = 0; i < bucketCount; i++) {
+                    uint64_t n = b->histogram[op][i].load(memory_order_relaxed);
+                    histogram[i] += n;
+                    count += n;
+                }
+                totalNs += b->totalNs[op].load(memory_order_relaxed);
+                maxNs = max(maxNs, b->maxNs[op].load(memory_order_relaxed));
+            }
+            if (!count) continue;
+            char row[160];
+            snprintf(row, sizeof(row), "%-15s %8llu %10.1f %10.1f %10.1f %10.1f %10.1f\n", opName((StatOp)op),
+                (unsigned long long)count, totalNs / 1e3 / count, percentile(histogram, count, maxNs, 0.5) / 1e3,
+                percentile(histogram, count, maxNs, 0.99) / 1e3, percentile(histogram, count, maxNs, 0.999) / 1e3,
+                maxNs / 1e3);
+            text += row;
+        }
+        uint64_t counters[CounterCount] = {};
+        for (Block* b : blocks())
+            for (int c = 0; c < CounterCount; c++) counters[c] += b->counters[c].load(memory_order_relaxed);
+        text += "bytes written: " + to_string(counters[CounterBytesWritten])
+            + ", records parsed: " + to_string(counters[CounterRecordsParsed]) + "\n";
+        return text;
+    }
+};
+
+class StatTimer {
+    StatOp op;
+    chrono::steady_clock::time_point start;
+public:
+    explicit StatTimer(StatOp op) noexcept : op(op), start(chrono::steady_clock::now()) {}
+    StatTimer(const StatTimer&) = delete;
+    StatTimer& operator=(const StatTimer&) = delete;
+    ~StatTimer() {
+        Stats::record(op, (uint64_t)chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start).count());
+    }
+};
+
+#define STATS_JOIN2(a, b) a##b
+#define STATS_JOIN(a, b) STATS_JOIN2(a, b)
+// Times the rest of the enclosing scope as `op`.
+#define STATS_TIME(op) StatTimer STATS_JOIN(statTimer, __LINE__)(op)
+#define STATS_COUNT(counter, n) Stats::add(counter, n)
+#else
+class Stats {
+public:
+    static constexpr bool enabled = false;
+    static string report() { return "Stats are compiled out (FINALPROJECT_NO_STATS).\n"; }
+};
+
+#define STATS_TIME(op) ((void)0)
+#define STATS_COUNT(counter, n) ((void)0)
+#endif
+
+// ==== FILE HELPERS ====
+static uint32_t fnv1a32(const char* data, size_t len) {
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < len; i++) {
+        h ^= (unsigned char)data[i];
+        h *= 16777619u;
+    }
+    return h;
+}
+
+// localtime() fills one buffer shared by all threads; this fills the caller's.
+static bool toLocalTime(time_t t, tm& out) {
+#ifdef _WIN32
+    return localtime_s(&out, &t) == 0;
+#else
+    return localtime_r(&t, &out) != nullptr;
+#endif
+}
+
+// Flushes stdio buffers and asks the OS to put the file on disk.
+static bool syncFile(FILE* f) {
+    if (fflush(f) != 0) return false;
+#ifdef _WIN32
+    return _commit(_fileno(f)) == 0;
+#else
+    return fsync(fileno(f)) == 0;
+#endif
+}
+
+// Makes a rename inside `dir` durable (POSIX; NTFS needs no extra step).
+static void syncDirectory(const fs::path& dir) {
+#ifndef _WIN32
+    int fd = ::open(dir.empty() ? "." : dir.c_str(), O_RDONLY);
+    if (fd >= 0) {
+        fsync(fd);
+        ::close(fd);
+    }
+#else
+    (void)dir;
+#endif
+}
+
+// Yeni faylı yanında yazıb sonra adını dəyişirik ki, yarımçıq fayl qalmasın.
+// durable = true also fsyncs the file and its directory. Not measured: the
+// Stats.txt dump uses it directly so that it does not count itself.
+static void replaceFile(const string& filePath, const string& content, bool durable = false) {
+    string tmpPath = filePath + ".tmp";
+    FILE* f = fopen(tmpPath.c_str(), "wb");
+    if (!f) throw string("File cannot be opened: " + tmpPath);
+    bool ok = fwrite(content.data(), 1, content.size(), f) == content.size();
+    ok = (durable ? syncFile(f) : fflush(f) == 0) && ok;
+    ok = fclose(f) == 0 && ok;
+    if (!ok) throw string("File cannot be written: " + tmpPath);
+    error_code ec;
+    fs::rename(tmpPath, filePath, ec);
+    if (ec) throw string("File cannot be replaced: " + filePath);
+    if (durable) syncDirectory(fs::path(filePath).parent_path());
+}
+
+static void writeFileAtomically(const string& filePath, const string& content, bool durable = false) {
+    STATS_TIME(StatFileRewrite);
+    replaceFile(filePath, content, durable);
+    STATS_COUNT(CounterBytesWritten, content.size());
+}
+
+// Writes a pre-rendered block with one call and one flush.
+static void writeBlock(ostream& os, const string& text) {
+    os.write(text.data(), (streamsize)text.size());
+    os.flush();
+}
+
+// Same text as `os << value` with the default stream format.
+static void appendNumber(string& out, double value) {
+    char buf[32];
+    int len = snprintf(buf, sizeof(buf), "%g", value);
+    out.append(buf, (size_t)len);
+}
+
+// Appends whole lines; a last line left without '\n' (e.g. by hand editing) is closed first.
+static void appendToFile(const string& filePath, const string& content, bool durable = false) {
+    STATS_TIME(StatFileAppend);
+    bool needsNewline = false;
+    if (FILE* last = fopen(filePath.c_str(), "rb")) {
+        if (fseek(last, -1, SEEK_END) == 0) needsNewline = fgetc(last) != '\n';
+        fclose(last);
+    }
+    FILE* f = fopen(filePath.c_str(), "ab");
+    if (!f) throw string("File cannot be opened: " + filePath);
+    bool ok = !needsNewline || fputc('\n', f) != EOF;
+    ok = fwrite(content.data(), 1, content.size(), f) == content.size() && ok;
+    ok = (durable ? syncFile(f) : fflush(f) == 0) && ok;
+    ok = fclose(f) == 0 && ok;
+    if (!ok) throw string("File cannot be written: " + filePath);
+    STATS_COUNT(CounterBytesWritten, content.size());
+}
+
+// Read-only memory mapping of a whole file.
+class MappedFile {
+    const char* base = nullptr;
+    size_t length = 0;
+#ifdef _WIN32
+    HANDLE file = INVALID_HANDLE_VALUE;
+    HANDLE mapping = nullptr;
+#endif
+public:
+    MappedFile() = default;
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    ~MappedFile() { close(); }
+
+    bool open(const string& path) {
+        close();
+#ifdef _WIN32
+        file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+            OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file == INVALID_HANDLE_VALUE) return false;
+        LARGE_INTEGER size;
+        if (!GetFileSizeEx(file, &size) || size.QuadPart == 0) { close(); return false; }
+        mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (!mapping) { close(); return false; }
+        base = (const char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+        if (!base) { close(); return false; }
+        length = (size_t)size.QuadPart;
+#else
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) return false;
+        struct stat st;
+        if (fstat(fd, &st) != 0 || st.st_size == 0) { ::close(fd); return false; }
+        void* p = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (p == MAP_FAILED) return false;
+        base = (const char*)p;
+        length = (size_t)st.st_size;
+#endif
+        return true;
+    }
+
+    void close() {
+#ifdef _WIN32
+        if (base) UnmapViewOfFile(base);
+        if (mapping) CloseHandle(mapping);
+        if (file != INVALID_HANDLE_VALUE) CloseHandle(file);
+        mapping = nullptr;
+        file = INVALID_HANDLE_VALUE;
+#else
+        if (base) munmap((void*)base, length);
+#endif
+        base = nullptr;
+        length = 0;
+    }
+
+    const char* data() const noexcept { return base; }
+    size_t size() const noexcept { return length; }
+};
+
+// ==== PERSISTENCE ====
+// Group commit for the data files. Stores call markDirty() instead of writing
+// and return at once; the flusher thread waits up to `window` so that a burst
+// of changes is written once, then collects the dirty stores' writes under
+// the data lock and performs them outside it, in registration order.
+// sync() is the durability barrier: it returns once every change marked
+// before the call is on disk.
+struct PersistConfig {
+    chrono::milliseconds window{ 50 };
+    bool fsync = false;
+};
+
+struct FileWrite {
+    string path;
+    string content;
+    bool append = false;                 // otherwise write-to-temp-then-rename
+    function<bool(bool durable)> apply;  // set: called under the data lock instead
+
+    FileWrite(string path, string content, bool append = false)
+        : path(move(path)), content(move(content)), append(append) {
+    }
+    FileWrite(string what, function<bool(bool durable)> apply) : path(move(what)), apply(move(apply)) {}
+};
+
+class Persister {
+public:
+    using Collect = function<void(vector<FileWrite>&)>;
+private:
+    PersistConfig config;
+    recursive_mutex dataMutex;  // stores hold it while changing rendered data
+    mutex stateMutex;           // dirty flags and counters below
+    condition_variable wake;
+    condition_variable roundDone;
+    vector<Collect> stores;
+    vector<char> dirty;
+    vector<FileWrite> retry;    // writes of a failed round, tried again first
+    uint64_t requested = 0;     // markDirty() calls so far
+    uint64_t completed = 0;     // requests known to be on disk
+    uint64_t failedRounds = 0;
+    bool urgent = false;
+    bool stopping = false;
+    bool stopped = false;
+    string lastError;
+    thread flusher;
+
+    void flushRound() {
+        STATS_TIME(StatFlushRound);
+        vector<size_t> due;
+        uint64_t target;
+        vector<FileWrite> writes;
+        {
+            lock_guard<mutex> lock(stateMutex);
+            target = requested;
+            urgent = false;
+            for (size_t i = 0; i < dirty.size(); i++)
+                if (dirty[i]) {
+                    due.push_back(i);
+                    dirty[i] = 0;
+                }
+            writes.swap(retry);
+        }
+        {
+            lock_guard<recursive_mutex> data(dataMutex);
+            for (size_t i : due) stores[i](writes);
+        }
+        string error;
+        size_t done = 0;
+        for (; done < writes.size(); done++) {
+            FileWrite& w = writes[done];
+            try {
+                if (w.apply) {
+                    lock_guard<recursive_mutex> data(dataMutex);
+                    if (!w.apply(config.fsync)) throw string("Cannot write " + w.path);
+                }
+                else if (w.append) appendToFile(w.path, w.content, config.fsync);
+                else writeFileAtomically(w.path, w.content, config.fsync);
+            }
+            catch (const string& ex) {
+                error = ex;
+                break;
+            }
+        }
+        lock_guard<mutex> lock(stateMutex);
+        if (error.empty()) completed = max(completed, target);
+        else {
+            // Sıra saxlanılır: uğursuz yazı və ondan sonrakılar növbəti dövrdə.
+            lastError = error;
+            failedRounds++;
+            retry.insert(retry.begin(), make_move_iterator(writes.begin() + done), make_move_iterator(writes.end()));
+        }
+        roundDone.notify_all();
+    }
+
+    void flusherLoop() {
+        unique_lock<mutex> lock(stateMutex);
+        for (;;) {
+            wake.wait(lock, [&] { return stopping || requested != completed; });
+            if (requested == completed) return; // stopping, nothing left
+            if (!stopping && !urgent)
+                wake.wait_for(lock, config.window, [&] { return stopping || urgent; });
+            bool last = stopping;
+            lock.unlock();
+            flushRound();
+            lock.lock();
+            if (last) return;
+        }
+    }
+public:
+    explicit Persister(PersistConfig config = {}) : config(config) {
+        flusher = thread([this] { flusherLoop(); });
+    }
+    Persister(const Persister&) = delete;
+    Persister& operator=(const Persister&) = delete;
+    ~Persister() {
+        try { shutdown(); }
+        catch (...) {}
+    }
+
+    // Registers a store; `collect` runs under the data lock and adds the store's writes.
+    size_t addStore(Collect collect) {
+        lock_guard<recursive_mutex> data(dataMutex);
+        lock_guard<mutex> lock(stateMutex);
+        stores.push_back(move(collect));
+        dirty.push_back(0);
+        return stores.size() - 1;
+    }
+
+    void markDirty(size_t store) {
+        lock_guard<mutex> lock(stateMutex);
+        dirty[store] = 1;
+        requested++;
+        wake.notify_one();
+    }
+
+    // Without a persister there is no flusher thread and the lock is empty.
+    static unique_lock<recursive_mutex> lockData(Persister* persister) {
+        return persister ? unique_lock<recursive_mutex>(persister->dataMutex) : unique_lock<recursive_mutex>();
+    }
+
+    // Must not be called while holding lockData().
+    void sync() {
+        unique_lock<mutex> lock(stateMutex);
+        uint64_t target = requested, failures = failedRounds;
+        if (completed >= target) return;
+        urgent = true;
+        wake.notify_one();
+        roundDone.wait(lock, [&] { return completed >= target || failedRounds != failures || stopped; });
+        if (completed < target) throw string("Cannot save data: " + lastError);
+    }
+
+    // Writes whatever is still dirty and stops the flusher.
+    void shutdown() {
+        {
+            lock_guard<mutex> lock(stateMutex);
+            if (stopping) return;
+            stopping = true;
+            wake.notify_one();
+        }
+        flusher.join();
+        lock_guard<mutex> lock(stateMutex);
+        stopped = true;
+        roundDone.notify_all();
+        if (completed < requested) throw string("Cannot save data: " + lastError);
+    }
+};
+
+// ==== TEXT PARSER ====
+// Shared reader for the underscore-delimited data files. Lines are read in
+// large blocks and handed out as string_views into the block; fields are split
+// without copying and numbers are converted with from_chars, so the only
+// allocations are the strings a loader decides to keep.
+class LineReader {
+    FILE* file = nullptr;
+    vector<char> buffer;
+    size_t begin = 0, end = 0;
+    size_t line = 0;
+    bool eof = false;
+
+    // Moves the unread tail to the front and reads the next block behind it.
+    bool fill() {
+        if (eof) return false;
+        if (begin > 0) {
+            memmove(buffer.data(), buffer.data() + begin, end - begin);
+            end -= begin;
+            begin = 0;
+        }
+        if (end == buffer.size()) buffer.resize(buffer.size() * 2); // sətir blokdan uzundur
+        size_t n = fread(buffer.data() + end, 1, buffer.size() - end, file);
+        if (n == 0) {
+            eof = true;
+            return false;
+        }
+        end += n;
+        return true;
+    }
+public:
+    // "-" reads standard input.
+    explicit LineReader(const string& path, size_t blockSize = 1 << 20) : buffer(blockSize) {
+        file = path == "-" ? stdin : fopen(path.c_str(), "rb");
+    }
+    LineReader(const LineReader&) = delete;
+    LineReader& operator=(const LineReader&) = delete;
+    ~LineReader() { if (file && file != stdin) fclose(file); }
+
+    bool isOpen() const noexcept { return file != nullptr; }
+    size_t lineNumber() const noexcept { return line; }
+
+    // The view stays valid until the next call.
+    bool next(string_view& out) {
+        if (!file) return false;
+        size_t scanFrom = begin;
+        for (;;) {
+            const char* nl = (const char*)memchr(buffer.data() + scanFrom, '\n', end - scanFrom);
+            if (nl) {
+                size_t len = (size_t)(nl - (buffer.data() + begin));
+                out = string_view(buffer.data() + begin, len);
+                begin += len + 1;
+                STATS_COUNT(CounterRecordsParsed, 1);
+                break;
+            }
+            size_t scanned = end - begin;
+            if (!fill()) {
+                if (begin == end) return false;
+                out = string_view(buffer.data() + begin, end - begin); // sonda '\n' yoxdur
+                begin = end;
+                break;
+            }
+            scanFrom = begin + scanned;
+        }
+        line++;
+        if (!out.empty() && out.back() == '\r') out.remove_suffix(1);
+        return true;
+    }
+};
+
+// Splits a row on a delimiter without copying.
+class FieldSplitter {
+    string_view rest;
+    char delim;
+    bool done = false;
+public:
+    FieldSplitter(string_view row, char delim = '_') : rest(row), delim(delim) {}
+
+    bool next(string_view& field) {
+        if (done) return false;
+        size_t pos = rest.find(delim);
+        if (pos == string_view::npos) {
+            field = rest;
+            done = true;
+        }
+        else {
+            field = rest.substr(0, pos);
+            rest.remove_prefix(pos + 1);
+        }
+        return true;
+    }
+
+    // Everything not yet returned by next().
+    string_view remainder() const noexcept { return done ? string_view() : rest; }
+};
+
+// The whole field must be a number.
+template <class T>
+static bool parseNumber(string_view text, T& out) {
+    const char* first = text.data();
+    const char* last = first + text.size();
+    if (first != last && *first == '+') first++;
+    if (first == last) return false;
+    auto res = from_chars(first, last, out);
+    return res.ec == errc() && res.ptr == last;
+}
+
+static void reportMalformedRow(const string& filePath, size_t line, const string& why) {
+    cout << "Skipped malformed row " << line << " in " << filePath << ": " << why << "\n";
+}
+
+// ==== BINARY SNAPSHOTS ====
+// Optional binary form of the four data files (Orders.bin, Dishes.bin,
+// StorageForIngredient.bin, User.bin). Layout:
+//   SnapshotHeader | fixed-size records | fixed-size aux records | string heap
+// Strings are StrRef (offset, length) into the heap. The checksum covers
+// everything after the header. Files are mapped and the records decoded
+// from the mapping without tokenizing, but they are still copied into the
+// stores; the mapping is closed once a file is loaded.
+// A store uses its .bin file when it exists; the text files stay as the
+// import/export format (see --convert in main).
+enum SnapshotKind {
+    SnapshotOrders = 1,
+    SnapshotDishes,
+    SnapshotStock,
+    SnapshotUsers
+};
+
+struct SnapshotHeader {
+    char magic[8];          // "FPSNAP\0\0"
+    uint32_t version;
+    uint32_t kind;
+    uint64_t recordCount;
+    uint32_t recordSize;
+    uint32_t auxRecordSize;
+    uint64_t auxCount;
+    uint64_t heapSize;
+    uint32_t checksum;
+    uint32_t endianTag;     // 0x01020304 in the writer's byte order
+};
+
+static const uint32_t snapshotVersion = 1;
+
+struct StrRef {
+    uint32_t offset;
+    uint32_t length;
+};
+
+class SnapshotWriter {
+    string records, aux, heap;
+    uint64_t recordCount = 0, auxCount = 0;
+public:
+    StrRef addString(string_view s) {
+        StrRef ref{ (uint32_t)heap.size(), (uint32_t)s.size() };
+        heap += s;
+        return ref;
+    }
+
+    template <class R>
+    void addRecord(const R& record) {
+        records.append((const char*)&record, sizeof(R));
+        recordCount++;
+    }
+
+    template <class A>
+    void addAux(const A& record) {
+        aux.append((const char*)&record, sizeof(A));
+        auxCount++;
+    }
+
+    uint64_t auxSize() const noexcept { return auxCount; }
+
+    string finish(SnapshotKind kind, uint32_t recordSize, uint32_t auxRecordSize = 0) const {
+        SnapshotHeader header{};
+        memcpy(header.magic, "FPSNAP\0\0", 8);
+        header.version = snapshotVersion;
+        header.kind = kind;
+        header.recordCount = recordCount;
+        header.recordSize = recordSize;
+        header.auxRecordSize = auxRecordSize;
+        header.auxCount = auxCount;
+        header.heapSize = heap.size();
+        header.endianTag = 0x01020304;
+        string out((const char*)&header, sizeof(header));
+        out.reserve(sizeof(header) + records.size() + aux.size() + heap.size());
+        out += records;
+        out += aux;
+        out += heap;
+        uint32_t sum = fnv1a32(out.data() + sizeof(header), out.size() - sizeof(header));
+        memcpy(&out[offsetof(SnapshotHeader, checksum)], &sum, sizeof(sum));
+        return out;
+    }
+};
+
+class SnapshotView {
+    MappedFile file;
+    const SnapshotHeader* header = nullptr;
+    const char* recordBase = nullptr;
+    const char* auxBase = nullptr;
+    const char* heapBase = nullptr;
+public:
+    // Maps and validates a snapshot. Returns "" on success or the reason it was rejected.
+    string open(const string& path, SnapshotKind kind, uint32_t recordSize, uint32_t auxRecordSize = 0) {
+        header = nullptr;
+        if (!file.open(path)) return "cannot map file";
+        if (file.size() < sizeof(SnapshotHeader)) return "file too short";
+        const SnapshotHeader* h = (const SnapshotHeader*)file.data();
+        if (memcmp(h->magic, "FPSNAP\0\0", 8) != 0) return "not a snapshot";
+        if (h->endianTag != 0x01020304) return "written on a different byte order";
+        if (h->version != snapshotVersion) return "unsupported version " + to_string(h->version);
+        if (h->kind != (uint32_t)kind || h->recordSize != recordSize || h->auxRecordSize != auxRecordSize)
+            return "wrong record layout";
+        // Counts are bounded first so that a damaged header cannot wrap the sum below.
+        uint64_t body = file.size() - sizeof(SnapshotHeader);
+        if (h->recordCount > body / recordSize || h->heapSize > body
+            || (auxRecordSize && h->auxCount > body / auxRecordSize))
+            return "size mismatch";
+        uint64_t expected = sizeof(SnapshotHeader) + h->recordCount * recordSize
+            + h->auxCount * auxRecordSize + h->heapSize;
+        if (expected != file.size()) return "size mismatch";
+        if (fnv1a32(file.data() + sizeof(SnapshotHeader), file.size() - sizeof(SnapshotHeader)) != h->checksum)
+            return "checksum mismatch";
+        header = h;
+        recordBase = file.data() + sizeof(SnapshotHeader);
+        auxBase = recordBase + h->recordCount * recordSize;
+        heapBase = auxBase + h->auxCount * auxRecordSize;
+        STATS_COUNT(CounterRecordsParsed, h->recordCount);
+        return "";
+    }
+
+    size_t count() const noexcept { return header ? (size_t)header->recordCount : 0; }
+    size_t auxCount() const noexcept { return header ? (size_t)header->auxCount : 0; }
+
+    template <class R>
+    const R* records() const noexcept { return (const R*)recordBase; }
+
+    template <class A>
+    const A* auxRecords() const noexcept { return (const A*)auxBase; }
+
+    // Out-of-range references read as empty strings.
+    string_view str(StrRef ref) const noexcept {
+        if (!header || (uint64_t)ref.offset + ref.length > header->heapSize) return string_view();
+        return string_view(heapBase + ref.offset, ref.length);
+    }
+};
+
+struct StockSnapshotRecord {
+    StrRef name;
+    double amount;
+};
+
+struct DishSnapshotRecord {
+    StrRef name;
+    StrRef description;
+    double price;
+    uint32_t firstIngredient; // aux cədvəldə
+    uint32_t ingredientCount;
+};
+
+struct IngredientSnapshotRecord {
+    StrRef name;
+    double amount;
+};
+
+struct OrderSnapshotRecord {
+    uint64_t id;
+    StrRef userId;
+    StrRef dishName;
+    uint32_t status;
+    uint32_t createdAt; // köhnə fayllarda 0 (pad idi)
+};
+
+struct UserSnapshotRecord {
+    StrRef id, username, password, email, name, surname, number, card;
+    uint16_t year;
+    uint8_t month;
+    uint8_t day;
+    uint8_t gender;
+    uint8_t pad[3];
+};
+
 // ==== INGREDIENT CLASS ====
 class Ingredient { // düz yazılış!
     string name;
@@ -29,13 +886,13 @@ class Ingredient { // düz yazılış!
 public:
     Ingredient() {}
     Ingredient(string name, double amount) {
-        setName(name);
+        setName(move(name));
         setAmount(amount);
     }
 
     void setName(string name) {
         if (name.empty()) throw string("Ingredient name cannot be empty!");
-        this->name = name;
+        this->name = move(name);
     }
 
     void setAmount(double amount) {
@@ -43,14 +900,15 @@ public:
         this->amount = amount;
     }
 
-    string getName() const noexcept { return name; }
+    const string& getName() const noexcept { return name; }
     double getAmount() const noexcept { return amount; }
 
-    void increase(double value) { amount += value; }
-    void decrease(double value) {
-        if (value > amount)
-            throw string("Not enough ingredient in stock: " + name);
+    void increase(double value) noexcept { amount += value; }
+    // Returns false and leaves the amount unchanged if there is not enough.
+    bool decrease(double value) noexcept {
+        if (value > amount) return false;
         amount -= value;
+        return true;
     }
 
     void showIngredient() const {
@@ -69,20 +927,20 @@ class Dish {
 public:
     Dish() = default;
 
-    Dish(const string name, const string& description, double price) {
-        setName(name);
-        setDescription(description);
+    Dish(string name, string description, double price) {
+        setName(move(name));
+        setDescription(move(description));
         setPrice(price);
     }
 
     void setName(string name) {
         if (name.empty()) throw string("Dish name cannot be empty!");
-        this->name = name;
+        this->name = move(name);
     }
 
     void setDescription(string description) {
         if (description.empty()) throw string("Dish description cannot be empty!");
-        this->description = description;
+        this->description = move(description);
     }
 
     void setPrice(double price) {
@@ -90,470 +948,5072 @@ public:
         this->price = price;
     }
 
-    string getName() const noexcept { return name; }
-    string getDescription() const noexcept { return description; }
+    const string& getName() const noexcept { return name; }
+    const string& getDescription() const noexcept { return description; }
     double getPrice() const noexcept { return price; }
-    vector<Ingredient> getIngredients() const noexcept { return ingredients; }
+    const vector<Ingredient>& getIngredients() const noexcept { return ingredients; }
 
-    void addIngredient(const Ingredient& ingredient) {
-        ingredients.push_back(ingredient);
+    void addIngredient(Ingredient ingredient) {
+        ingredients.push_back(move(ingredient));
     }
 
-    void show() const {
-        cout << "Dish Name: " << name << "\n";
-        cout << "Description: " << description << "\n";
-        cout << "Price: " << price << "\n";
-        cout << "Ingredients:\n";
+    // Appends the text show() prints.
+    void render(string& out) const {
+        out += "Dish Name: " + name + "\nDescription: " + description + "\nPrice: ";
+        appendNumber(out, price);
+        out += "\nIngredients:\n";
         if (ingredients.empty()) {
-            cout << "  (No ingredients)\n";
+            out += "  (No ingredients)\n";
         }
         else {
             for (const auto& ing : ingredients) {
-                cout << "  - " << ing.getName()
-                    << " (Amount: " << ing.getAmount() << ")\n";
+                out += "  - " + ing.getName() + " (Amount: ";
+                appendNumber(out, ing.getAmount());
+                out += ")\n";
             }
         }
     }
+
+    void show() const {
+        string text;
+        render(text);
+        writeBlock(cout, text);
+    }
 };
 
 // ==== STOCK CLASS ====
+// Hash and equality that ignore ASCII case without building lowered copies.
+struct CaseInsensitiveHash {
+    size_t operator()(const string& s) const noexcept {
+        size_t h = 1469598103934665603ull; // FNV-1a
+        for (unsigned char c : s) {
+            h ^= (size_t)tolower(c);
+            h *= 1099511628211ull;
+        }
+        return h;
+    }
+};
+
+struct CaseInsensitiveEqual {
+    bool operator()(const string& a, const string& b) const noexcept {
+        if (a.size() != b.size()) return false;
+        for (size_t i = 0; i < a.size(); i++)
+            if (tolower((unsigned char)a[i]) != tolower((unsigned char)b[i])) return false;
+        return true;
+    }
+};
+
+// A dish compiled against the stock layout: which stock slots it uses and
+// how much of each. Built once per menu change, so deduction does no name work.
+struct RecipeLine {
+    uint32_t slot;
+    double amount;
+};
+
+struct Recipe {
+    vector<RecipeLine> lines;
+    string missing;         // stokda olmayan ilk ingredient ("" = hamısı tapılıb)
+    size_t stockSlots = 0;  // compile zamanı stokdakı slot sayı
+};
+
+// The one inventory of the restaurant: Admin restocks and OrderManager
+// deducts from the same instance (created in main and passed by reference).
+// Quantities are kept as a structure of arrays indexed by slot; slots are
+// only ever appended, so compiled recipes stay valid as the stock grows.
+// `reserved` is what accepted but not yet prepared orders have claimed;
+// new orders can only reserve from amounts - reserved.
+// Every change of a slot's free amount (amounts - reserved) is recorded in
+// changedSlots for incremental readers (see forEachChangedSlot).
 class Stock {
-    vector<Ingredient> storage;
+    vector<string> names;
+    vector<double> amounts;
+    vector<double> reserved;
+    vector<uint8_t> slotChanged;    // slot is already in changedSlots
+    vector<uint32_t> changedSlots;
+    bool allChanged = true;         // yükləmə, yeni slot və s.: hamısı dəyişmiş sayılır
+    string dir;                  // data directory ("" = current), ends with '/'
+    bool binarySnapshot = false; // StorageForIngredient.bin istifadə olunur
+    Persister* persister = nullptr;
+    size_t persistSlot = 0;
+    // açar: kiçik hərflə ingredient adı, dəyər: slot
+    unordered_map<string, uint32_t, CaseInsensitiveHash, CaseInsensitiveEqual> slotByName;
+
+    long findSlot(const string& name) const {
+        auto it = slotByName.find(name);
+        return it == slotByName.end() ? -1 : (long)it->second;
+    }
+
+    void addSlot(const string& name, double amount) {
+        slotByName.emplace(name, (uint32_t)names.size());
+        appendSlot(name, amount);
+    }
+
+    // The slot arrays only; the caller has already put the name in slotByName.
+    void appendSlot(const string& name, double amount) {
+        names.push_back(name);
+        amounts.push_back(amount);
+        reserved.push_back(0.0);
+        slotChanged.push_back(0);
+        allChanged = true;
+    }
+
+    void touch(uint32_t slot) noexcept {
+        if (slotChanged[slot]) return;
+        slotChanged[slot] = 1;
+        changedSlots.push_back(slot);
+    }
+
+    void touch(const Recipe& recipe) noexcept {
+        for (const RecipeLine& line : recipe.lines) touch(line.slot);
+    }
 
-    static string toLower(string s) {
-        for (auto& c : s) c = tolower(c);
-        return s;
+    void touch(const vector<double>& demand) noexcept {
+        for (size_t i = 0; i < demand.size(); i++)
+            if (demand[i] != 0.0) touch((uint32_t)i);
     }
 public:
-    Stock() {
-        try { loadStorage(); }
+    explicit Stock(string dataDir = "") : dir(move(dataDir)) {
+        binarySnapshot = fs::exists(dir + "StorageForIngredient.bin");
+        try {
+            if (!binarySnapshot || !loadSnapshot(dir + "StorageForIngredient.bin")) loadStorage(dir + "StorageForIngredient.txt");
+        }
         catch (...) {}
     }
+    Stock(const Stock&) = delete;
+    Stock& operator=(const Stock&) = delete;
+
+    size_t slotCount() const noexcept { return names.size(); }
 
     void addIngredient(const Ingredient& ingredient) {
-        for (auto& stock : storage) {
-            if (toLower(stock.getName()) == toLower(ingredient.getName())) {
-                stock.increase(ingredient.getAmount());
-                saveStorage();
-                cout << "Ingredient amount increased: " << stock.getName() << endl;
-                return;
-            }
+        if (restock(ingredient.getName(), ingredient.getAmount()))
+            cout << "Ingredient added to stock: " << ingredient.getName() << endl;
+        else
+            cout << "Ingredient amount increased: " << ingredient.getName() << endl;
+    }
+
+    // addIngredient() without the console message; returns true for a new ingredient.
+    bool restock(const string& name, double amount) {
+        auto data = Persister::lockData(persister);
+        long slot = findSlot(name);
+        if (slot >= 0) {
+            amounts[slot] += amount;
+            touch((uint32_t)slot);
         }
-        storage.push_back(ingredient);
+        else addSlot(name, amount);
         saveStorage();
-        cout << "Ingredient added to stock: " << ingredient.getName() << endl;
+        return slot < 0;
+    }
+
+    // f(name, amount, reserved) for every ingredient, in stock order.
+    template <class F>
+    void forEachIngredient(F f) const {
+        for (size_t i = 0; i < names.size(); i++) f(names[i], amounts[i], reserved[i]);
     }
 
-    void useIngredient(const Dish& dish) {
+    Recipe compile(const Dish& dish) const {
+        Recipe recipe;
+        recipe.stockSlots = names.size();
         for (const auto& ing : dish.getIngredients()) {
-            bool found = false;
-            for (auto& ingStock : storage) {
-                if (toLower(ingStock.getName()) == toLower(ing.getName())) {
-                    ingStock.decrease(ing.getAmount());
-                    found = true;
-                    break;
-                }
+            long slot = findSlot(ing.getName());
+            if (slot < 0) {
+                if (recipe.missing.empty()) recipe.missing = ing.getName();
+                continue;
             }
-            if (!found)
-                throw string("Ingredient not found in stock: " + ing.getName());
+            // Eyni ingredient iki dəfə yazılıbsa, miqdarları birləşdiririk.
+            auto same = std::find_if(recipe.lines.begin(), recipe.lines.end(),
+                [&](const RecipeLine& l) { return l.slot == (uint32_t)slot; });
+            if (same != recipe.lines.end()) same->amount += ing.getAmount();
+            else recipe.lines.push_back({ (uint32_t)slot, ing.getAmount() });
         }
-        saveStorage();
-        cout << "Stock updated for dish: " << dish.getName() << endl;
+        return recipe;
     }
 
-    void loadStorage(string filePath = "StorageForIngredient.txt") {
-        storage.clear();
-        ifstream fs(filePath);
-        if (!fs.is_open()) {
-            ofstream create(filePath);
-            create.close();
-            return;
+    // Returns the first line that unreserved stock cannot cover, or -1 if all can be covered.
+    long findShortage(const Recipe& recipe) const noexcept {
+        const double* have = amounts.data();
+        const double* held = reserved.data();
+        for (size_t i = 0; i < recipe.lines.size(); i++) {
+            uint32_t slot = recipe.lines[i].slot;
+            if (have[slot] - held[slot] < recipe.lines[i].amount) return (long)i;
         }
-        string row;
-        while (getline(fs, row)) {
-            if (row.empty()) continue;
+        return -1;
+    }
 
-            string name;
-            double amount = 0;
-            size_t pos = row.find('_');
-            if (pos != string::npos) {
-                name = row.substr(0, pos);
-                amount = stod(row.substr(pos + 1));
-                storage.push_back(Ingredient(name, amount));
-            }
-        }
+    void deduct(const Recipe& recipe) noexcept {
+        double* have = amounts.data();
+        for (const RecipeLine& line : recipe.lines)
+            have[line.slot] -= line.amount;
+        touch(recipe);
     }
 
-    void saveStorage(string filePath = "StorageForIngredient.txt") {
-        ofstream fs(filePath);
-        if (!fs.is_open()) throw string("File cannot be opened!");
-        for (auto& s : storage)
-            fs << s.getName() << "_" << s.getAmount() << "\n";
-        fs.close();
+    // How many times the recipe can still be made from unreserved stock
+    // (UINT32_MAX for a recipe without ingredients, 0 if one is missing).
+    uint32_t servings(const Recipe& recipe) const noexcept {
+        if (!recipe.missing.empty()) return 0;
+        double best = (double)UINT32_MAX;
+        for (const RecipeLine& line : recipe.lines)
+            best = min(best, floor((amounts[line.slot] - reserved[line.slot]) / line.amount));
+        return best > 0 ? (uint32_t)best : 0;
     }
 
-    void showStock() const {
-        if (storage.empty()) throw string("Stock is empty!");
-        cout << "Current Stock:\n";
-        for (auto& ing : storage)
-            ing.showIngredient();
+    // Calls f(slot) for every slot whose free amount changed since the last
+    // call and forgets them. Returns false (without calling f) when everything
+    // has to be treated as changed, e.g. after a load or a new ingredient.
+    template <class F>
+    bool forEachChangedSlot(F f) {
+        bool partial = !allChanged;
+        if (partial)
+            for (uint32_t slot : changedSlots) f(slot);
+        for (uint32_t slot : changedSlots) slotChanged[slot] = 0;
+        changedSlots.clear();
+        allChanged = false;
+        return partial;
     }
-};
 
-// ==== ORDER CLASS ====
-class Order {
-public:
-    string userId;
-    string dishName;
-    OrderStatus status;
+    const string& slotName(uint32_t slot) const { return names[slot]; }
 
-    Order(string userId, string dishName, int st = (int)Received)
-        : userId(userId), dishName(dishName), status((OrderStatus)st) {
+    // Reserves the recipe against unreserved stock, all or nothing.
+    // Returns the first line that cannot be covered, or -1 on success.
+    // Every deduction is checked against unreserved stock too, so
+    // amounts >= reserved always holds and a reservation can always be committed.
+    long reserve(const Recipe& recipe) noexcept {
+        long shortLine = findShortage(recipe);
+        if (shortLine >= 0) return shortLine;
+        for (const RecipeLine& line : recipe.lines)
+            reserved[line.slot] += line.amount;
+        touch(recipe);
+        return -1;
     }
 
-    // Seriyalizasiya üçün
-    string toString() const {
-        return userId + "_" + dishName + "_" + to_string((int)status);
+    void release(const Recipe& recipe) noexcept {
+        for (const RecipeLine& line : recipe.lines)
+            reserved[line.slot] = max(0.0, reserved[line.slot] - line.amount);
+        touch(recipe);
     }
-    static Order fromString(const string& data) {
-        stringstream ss(data);
-        string userId, dishName, statusStr;
-        getline(ss, userId, '_');
-        getline(ss, dishName, '_');
-        getline(ss, statusStr);
-        int st = stoi(statusStr);
-        return Order(userId, dishName, st);
+
+    // Turns a reservation into a real deduction.
+    void commitReservation(const Recipe& recipe) noexcept {
+        release(recipe);
+        deduct(recipe);
     }
-};
 
-// ==== ORDER MANAGER ====
-class OrderManager {
-    vector<Order> orders;
-    vector<Dish>* dishesRef = nullptr;
-    Stock stock;
+    void clearReservations() noexcept {
+        fill(reserved.begin(), reserved.end(), 0.0);
+        allChanged = true;
+    }
 
-    string statusToString(OrderStatus st) const {
-        switch (st) {
-        case Received: return "Received";
-        case Preparing: return "Preparing";
-        case Cooking: return "Cooking";
-        case Packed: return "Packed";
-        case Ready: return "Ready";
+    // Batch helpers: `demand` is a dense per-slot total (size == slotCount()).
+    static void addDemand(const Recipe& recipe, vector<double>& demand) noexcept {
+        for (const RecipeLine& line : recipe.lines)
+            demand[line.slot] += line.amount;
+    }
+
+    // Checks unreserved stock against a demand that holds no reservation.
+    bool covers(const vector<double>& demand) const noexcept {
+        bool ok = true;
+        for (size_t i = 0; i < demand.size(); i++)
+            ok &= amounts[i] - reserved[i] >= demand[i];
+        return ok;
+    }
+
+    void deductDemand(const vector<double>& demand) noexcept {
+        for (size_t i = 0; i < demand.size(); i++)
+            amounts[i] -= demand[i];
+        touch(demand);
+    }
+
+    void commitReservedDemand(const vector<double>& demand) noexcept {
+        for (size_t i = 0; i < demand.size(); i++) {
+            amounts[i] -= demand[i];
+            reserved[i] = max(0.0, reserved[i] - demand[i]);
+        }
+        touch(demand);
+    }
+
+    static constexpr long RecipeMissing = -2;
+
+    // All-or-nothing: nothing is subtracted unless every line can be covered.
+    // Returns -1 on success, RecipeMissing if an ingredient is not in stock at
+    // all (recipe.missing), or the first line that is short. Failures do not
+    // allocate; the caller builds the message if it wants one.
+    long useRecipe(const Recipe& recipe, string_view dishName) {
+        auto data = Persister::lockData(persister);
+        if (!recipe.missing.empty()) return RecipeMissing;
+        long shortLine = findShortage(recipe);
+        if (shortLine >= 0) return shortLine;
+        deduct(recipe);
+        saveStorage();
+        cout << "Stock updated for dish: " << dishName << endl;
+        return -1;
+    }
+
+    void clearStorage() {
+        names.clear();
+        amounts.clear();
+        reserved.clear();
+        slotChanged.clear();
+        changedSlots.clear();
+        allChanged = true;
+        slotByName.clear();
+    }
+
+    bool loadSnapshot(const string& filePath = "StorageForIngredient.bin") {
+        clearStorage();
+        SnapshotView view;
+        string error = view.open(filePath, SnapshotStock, sizeof(StockSnapshotRecord));
+        if (!error.empty()) {
+            cout << "Cannot use " << filePath << " (" << error << "), reading text file.\n";
+            return false;
+        }
+        const StockSnapshotRecord* rec = view.records<StockSnapshotRecord>();
+        names.reserve(view.count());
+        amounts.reserve(view.count());
+        reserved.reserve(view.count());
+        slotChanged.reserve(view.count());
+        for (size_t i = 0; i < view.count(); i++) {
+            string name(view.str(rec[i].name));
+            long slot = findSlot(name);
+            if (slot >= 0) amounts[slot] += rec[i].amount;
+            else addSlot(name, rec[i].amount);
+        }
+        return true;
+    }
+
+    string renderSnapshot() const {
+        SnapshotWriter writer;
+        for (size_t i = 0; i < names.size(); i++) {
+            StockSnapshotRecord rec{};
+            rec.name = writer.addString(names[i]);
+            rec.amount = amounts[i];
+            writer.addRecord(rec);
+        }
+        return writer.finish(SnapshotStock, sizeof(StockSnapshotRecord));
+    }
+
+    void loadStorage(string filePath = "StorageForIngredient.txt") {
+        clearStorage();
+        LineReader reader(filePath);
+        if (!reader.isOpen()) {
+            ofstream create(filePath);
+            create.close();
+            return;
+        }
+        string_view row;
+        while (reader.next(row)) {
+            if (row.empty()) continue;
+            size_t pos = row.find('_');
+            double amount = 0;
+            if (pos == string_view::npos || pos == 0 || !parseNumber(row.substr(pos + 1), amount) || amount <= 0) {
+                reportMalformedRow(filePath, reader.lineNumber(), "expected name_amount");
+                continue;
+            }
+            // One hash lookup per row: the insert doubles as the duplicate check.
+            auto known = slotByName.try_emplace(string(row.substr(0, pos)), (uint32_t)names.size());
+            if (known.second) appendSlot(known.first->first, amount);
+            else amounts[known.first->second] += amount;
+        }
+    }
+
+    string renderStorage() const {
+        stringstream ss;
+        for (size_t i = 0; i < names.size(); i++)
+            ss << names[i] << "_" << amounts[i] << "\n";
+        return ss.str();
+    }
+
+    string storagePath() const {
+        return dir + (binarySnapshot ? "StorageForIngredient.bin" : "StorageForIngredient.txt");
+    }
+
+    // Content of storagePath() in the format in use.
+    string renderForDisk() const {
+        return binarySnapshot ? renderSnapshot() : renderStorage();
+    }
+
+    // With a persister attached the file is only marked dirty; the caller holds
+    // Persister::lockData() while it changes amounts.
+    void saveStorage() {
+        if (persister) persister->markDirty(persistSlot);
+        else writeFileAtomically(storagePath(), renderForDisk());
+    }
+
+    void setPersister(Persister* p) {
+        persister = p;
+        persistSlot = p->addStore([this](vector<FileWrite>& writes) {
+            writes.emplace_back(storagePath(), renderForDisk());
+        });
+    }
+
+    // Switches between StorageForIngredient.bin and the text file (see --convert).
+    void setBinarySnapshot(bool on) {
+        binarySnapshot = on;
+        saveStorage();
+        if (!on) {
+            error_code ec;
+            fs::remove(dir + "StorageForIngredient.bin", ec);
+        }
+    }
+
+    void showStock() const {
+        if (names.empty()) throw string("Stock is empty!");
+        cout << "Current Stock:\n";
+        for (size_t i = 0; i < names.size(); i++) {
+            cout << "---------------------------------\n";
+            cout << "Ingredient Name: " << names[i] << "\n";
+            cout << "Ingredient Amount: " << amounts[i] << "\n";
+            if (reserved[i] > 0)
+                cout << "Reserved by orders: " << reserved[i] << "\n";
+        }
+    }
+};
+
+// ==== ORDER CLASS ====
+// Row form of an order: parsing, serialization and listing pages. Stored
+// orders live in OrderStore's columns, not as Order objects.
+class Order {
+public:
+    uint64_t id = 0; // 0 = hələ nömrə verilməyib
+    string userId;
+    string dishName;
+    OrderStatus status;
+    uint32_t createdAt = 0; // Unix saniyə; 0 = məlum deyil (köhnə fayllar)
+
+    Order(uint64_t id, string userId, string dishName, int st = (int)Received, uint32_t createdAt = 0)
+        : id(id), userId(move(userId)), dishName(move(dishName)), status((OrderStatus)st), createdAt(createdAt) {
+    }
+
+    // Seriyalizasiya üçün: id_userId_dishName_status_createdAt
+    string toString() const {
+        return to_string(id) + "_" + userId + "_" + dishName + "_" + to_string((int)status) + "_" + to_string(createdAt);
+    }
+    // Köhnə fayllarda id yoxdur (userId_dishName_status); onlara yükləmədə id verilir.
+    // createdAt-sız sətirlər (id_userId_dishName_status) də oxunur.
+    static bool parse(string_view data, Order& out) {
+        size_t fields = 1;
+        for (char c : data) if (c == '_') fields++;
+        if (fields < 3) return false;
+        FieldSplitter split(data);
+        string_view idStr, userId, dishName, statusStr;
+        uint64_t id = 0;
+        int st = 0;
+        uint32_t createdAt = 0;
+        if (fields >= 4) {
+            split.next(idStr);
+            if (!parseNumber(idStr, id)) return false;
+        }
+        split.next(userId);
+        split.next(dishName);
+        if (fields >= 5) {
+            split.next(statusStr);
+            if (!parseNumber(split.remainder(), createdAt)) return false;
+        }
+        else statusStr = split.remainder();
+        if (userId.empty() || dishName.empty() || !parseNumber(statusStr, st)
+            || st < Received || st > Cancelled) return false;
+        out = Order(id, string(userId), string(dishName), st, createdAt);
+        return true;
+    }
+
+    static Order fromString(string_view data) {
+        Order ord(0, "", "");
+        if (!parse(data, ord)) throw string("Invalid order row!");
+        return ord;
+    }
+};
+
+// ==== ORDER STORE ====
+// Dense 32-bit keys for strings repeated across many orders (user IDs, dish
+// names). Keys are never reused, not even by OrderStore::clear(); names live
+// in a deque so the string_view keys of the map stay valid.
+class NamePool {
+    deque<string> names;
+    unordered_map<string_view, uint32_t> keyByName;
+public:
+    static constexpr uint32_t None = UINT32_MAX;
+
+    uint32_t intern(string_view name) {
+        auto it = keyByName.find(name);
+        if (it != keyByName.end()) return it->second;
+        names.emplace_back(name);
+        uint32_t key = (uint32_t)(names.size() - 1);
+        keyByName.emplace(names.back(), key);
+        return key;
+    }
+
+    uint32_t find(string_view name) const {
+        auto it = keyByName.find(name);
+        return it == keyByName.end() ? None : it->second;
+    }
+
+    const string& name(uint32_t key) const { return names[key]; }
+    size_t size() const { return names.size(); }
+};
+
+// Filter and cursor of a paged order listing. `cursor` is the resume token of
+// the previous page (OrderPage::next); 0 starts at the oldest order.
+struct OrderQuery {
+    uint32_t statusMask = ~0u;  // bit (1 << status) per accepted status
+    string userId;              // empty: any user
+    string dishName;            // empty: any dish
+    size_t pageSize = 20;       // 1..MaxPageSize where it is typed in
+    uint64_t cursor = 0;
+
+    static const size_t MaxPageSize = 1000;
+    static uint32_t statusBit(OrderStatus st) { return 1u << st; }
+};
+
+struct OrderPage {
+    vector<Order> orders;
+    uint64_t next = 0;          // resume token, 0 = no more pages
+};
+
+// Orders in creation order as fixed-size columns (ID, user key, dish key,
+// status, creation time); user IDs and dish names are interned. A stored
+// order is addressed by its slot, which only moves when removeIf() drops
+// orders (archiving), so a slot number also works as a listing cursor. Order IDs map to slots through a dense table
+// (IDs are handed out sequentially) with a hash map for outliers.
+// slotsByUser makes per-user lookups O(k). Every slot is also linked into the
+// list of its status (oldest arrival in that status first), so a stage's
+// orders and the per-stage counts need no scan.
+class OrderStore {
+public:
+    static constexpr size_t NoSlot = SIZE_MAX;
+private:
+    static constexpr int StatusCount = Cancelled + 1;
+    // Slots are stored as 32 bits inside the indexes.
+    static constexpr uint32_t NoLink = UINT32_MAX;
+    struct BucketLink {
+        uint32_t prev = NoLink;
+        uint32_t next = NoLink;
+    };
+
+    vector<uint64_t> ids;
+    vector<uint32_t> userKeys;
+    vector<uint32_t> dishKeys;
+    vector<uint8_t> statuses;
+    vector<uint32_t> created;
+    vector<BucketLink> links;
+    NamePool users, dishes;
+    uint32_t head[StatusCount];
+    uint32_t tail[StatusCount];
+    size_t counts[StatusCount];
+    vector<uint32_t> slotOfId;                      // ID -> slot, NoLink if unused
+    unordered_map<uint64_t, uint32_t> sparseSlots;  // IDs too large for slotOfId
+    vector<vector<uint32_t>> slotsByUser;           // by user key, sorted
+    uint64_t nextId = 1;
+
+    void mapId(uint64_t id, size_t slot) {
+        if (id >= slotOfId.size() && id <= 2 * ids.size() + 4096)
+            slotOfId.resize(max<size_t>((size_t)id + 1, slotOfId.size() * 3 / 2), NoLink);
+        if (id < slotOfId.size()) slotOfId[id] = (uint32_t)slot;
+        else sparseSlots[id] = (uint32_t)slot;
+    }
+
+    void link(size_t slot) {
+        int st = statuses[slot];
+        links[slot] = BucketLink{ tail[st], NoLink };
+        if (tail[st] == NoLink) head[st] = (uint32_t)slot;
+        else links[tail[st]].next = (uint32_t)slot;
+        tail[st] = (uint32_t)slot;
+        counts[st]++;
+    }
+
+    void unlink(size_t slot) {
+        int st = statuses[slot];
+        const BucketLink& l = links[slot];
+        if (l.prev == NoLink) head[st] = l.next;
+        else links[l.prev].next = l.next;
+        if (l.next == NoLink) tail[st] = l.prev;
+        else links[l.next].prev = l.prev;
+        counts[st]--;
+    }
+
+    void resetBuckets() {
+        fill(begin(head), end(head), NoLink);
+        fill(begin(tail), end(tail), NoLink);
+        fill(begin(counts), end(counts), (size_t)0);
+    }
+
+    // Status-filtered page gathered from the buckets instead of a slot scan:
+    // keeps the pageSize + 1 smallest matching slots at or after the cursor;
+    // the extra one is not shown, it is where the next page starts.
+    void queryBuckets(const OrderQuery& q, uint32_t dishKey, OrderPage& page) const {
+        // A page never holds more than every order, so the + 1 cannot wrap.
+        size_t keep = min<size_t>(q.pageSize, ids.size()) + 1;
+        vector<uint32_t> best;  // max-heap
+        best.reserve(min<size_t>(keep, 256) + 1);
+        for (int st = 0; st < StatusCount; st++) {
+            if (!(q.statusMask & OrderQuery::statusBit((OrderStatus)st))) continue;
+            for (uint32_t slot = head[st]; slot != NoLink; slot = links[slot].next) {
+                if (slot < q.cursor) continue;
+                if (best.size() == keep && slot > best.front()) continue;
+                if (dishKey != NamePool::None && dishKeys[slot] != dishKey) continue;
+                best.push_back(slot);
+                push_heap(best.begin(), best.end());
+                if (best.size() > keep) {
+                    pop_heap(best.begin(), best.end());
+                    best.pop_back();
+                }
+            }
+        }
+        sort_heap(best.begin(), best.end());
+        if (best.size() == keep) {
+            page.next = best.back();
+            best.pop_back();
+        }
+        for (uint32_t slot : best) page.orders.push_back(get(slot));
+    }
+public:
+    OrderStore() { resetBuckets(); }
+
+    size_t add(const string& userId, const string& dishName, uint32_t createdAt) {
+        return insert(Order(nextId, userId, dishName, (int)Received, createdAt));
+    }
+
+    // Inserts a loaded order; an order with a known ID replaces the old copy.
+    size_t insert(const Order& order) {
+        uint64_t id = order.id ? order.id : nextId;
+        uint32_t user = users.intern(order.userId);
+        size_t slot = find(id);
+        if (slot != NoSlot) {
+            if (userKeys[slot] != user) {
+                auto& slots = slotsByUser[userKeys[slot]];
+                slots.erase(std::find(slots.begin(), slots.end(), (uint32_t)slot));
+                if (user >= slotsByUser.size()) slotsByUser.resize(user + 1);
+                // Sıralı saxlayırıq ki, query() kursordan binary search ilə başlasın.
+                auto& target = slotsByUser[user];
+                target.insert(lower_bound(target.begin(), target.end(), (uint32_t)slot), (uint32_t)slot);
+            }
+            unlink(slot);
+            userKeys[slot] = user;
+            dishKeys[slot] = dishes.intern(order.dishName);
+            statuses[slot] = (uint8_t)order.status;
+            created[slot] = order.createdAt;
+            link(slot);
+            return slot;
+        }
+        if (id >= nextId) nextId = id + 1;
+        slot = ids.size();
+        ids.push_back(id);
+        userKeys.push_back(user);
+        dishKeys.push_back(dishes.intern(order.dishName));
+        statuses.push_back((uint8_t)order.status);
+        created.push_back(order.createdAt);
+        links.emplace_back();
+        mapId(id, slot);
+        if (user >= slotsByUser.size()) slotsByUser.resize(user + 1);
+        slotsByUser[user].push_back((uint32_t)slot);
+        link(slot);
+        return slot;
+    }
+
+    // Slot of an order ID, NoSlot if unknown.
+    size_t find(uint64_t id) const {
+        if (id < slotOfId.size() && slotOfId[id] != NoLink) return slotOfId[id];
+        if (sparseSlots.empty()) return NoSlot;
+        auto it = sparseSlots.find(id);
+        return it == sparseSlots.end() ? NoSlot : it->second;
+    }
+
+    uint64_t id(size_t slot) const { return ids[slot]; }
+    OrderStatus status(size_t slot) const { return (OrderStatus)statuses[slot]; }
+    uint32_t createdAt(size_t slot) const { return created[slot]; }
+    uint32_t userKey(size_t slot) const { return userKeys[slot]; }
+    uint32_t dishKey(size_t slot) const { return dishKeys[slot]; }
+    const string& userId(size_t slot) const { return users.name(userKeys[slot]); }
+    const string& dishName(size_t slot) const { return dishes.name(dishKeys[slot]); }
+
+    Order get(size_t slot) const {
+        return Order(ids[slot], userId(slot), dishName(slot), statuses[slot], created[slot]);
+    }
+
+    // Appends the slot's id_userId_dishName_status_createdAt row and a newline.
+    void appendRow(size_t slot, string& out) const {
+        out += to_string(ids[slot]);
+        out += '_';
+        out += userId(slot);
+        out += '_';
+        out += dishName(slot);
+        out += '_';
+        out += to_string((int)statuses[slot]);
+        out += '_';
+        out += to_string(created[slot]);
+        out += '\n';
+    }
+
+    uint32_t internDish(string_view dishName) { return dishes.intern(dishName); }
+    uint32_t findDish(string_view dishName) const { return dishes.find(dishName); }
+    uint32_t findUser(string_view userId) const { return users.find(userId); }
+
+    void setStatus(size_t slot, OrderStatus status) {
+        if (statuses[slot] == status) return;
+        unlink(slot);
+        statuses[slot] = (uint8_t)status;
+        link(slot);
+    }
+
+    size_t countInStatus(OrderStatus status) const { return counts[status]; }
+
+    // Visits the slots in `status`, longest in that status first, until f returns false.
+    template <class F>
+    void forEachInStatus(OrderStatus status, F f) const {
+        for (uint32_t slot = head[status]; slot != NoLink; slot = links[slot].next)
+            if (!f((size_t)slot)) return;
+    }
+
+    template <class F>
+    void forEachOfUser(const string& userId, F f) const {
+        uint32_t user = users.find(userId);
+        if (user == NamePool::None || user >= slotsByUser.size()) return;
+        for (uint32_t slot : slotsByUser[user]) f((size_t)slot);
+    }
+
+    // One page of matching orders, oldest first. The work done is the orders
+    // looked at from the cursor on (only the user's own with a user filter).
+    // A resume token is only handed out once one more match is seen after a
+    // full page, so the last page never leads to an empty one.
+    OrderPage query(const OrderQuery& q) const {
+        OrderPage page;
+        if (q.pageSize == 0) return page;
+        uint32_t dishKey = NamePool::None;
+        if (!q.dishName.empty()) {
+            dishKey = dishes.find(q.dishName);
+            if (dishKey == NamePool::None) return page;
+        }
+        page.orders.reserve(min<size_t>(q.pageSize, 256));
+        auto take = [&](size_t slot) {
+            if (!(q.statusMask & OrderQuery::statusBit((OrderStatus)statuses[slot]))) return false;
+            if (dishKey != NamePool::None && dishKeys[slot] != dishKey) return false;
+            if (page.orders.size() < q.pageSize) {
+                page.orders.push_back(get(slot));
+                return false;
+            }
+            page.next = slot;
+            return true;
+        };
+        if (!q.userId.empty()) {
+            uint32_t user = users.find(q.userId);
+            if (user == NamePool::None || user >= slotsByUser.size()) return page;
+            const vector<uint32_t>& slots = slotsByUser[user];
+            if (q.cursor >= ids.size()) return page;
+            for (auto s = lower_bound(slots.begin(), slots.end(), (uint32_t)q.cursor); s != slots.end(); ++s)
+                if (take(*s)) break;
+        }
+        else {
+            size_t inStatus = 0;
+            for (int st = 0; st < StatusCount; st++)
+                if (q.statusMask & OrderQuery::statusBit((OrderStatus)st)) inStatus += counts[st];
+            // Seçilmiş statuslar azdırsa (məs. böyük Ready arxivində aktivlər) bucket-lərdən yığırıq.
+            if (inStatus * 4 < ids.size() - min<size_t>(q.cursor, ids.size()))
+                queryBuckets(q, dishKey, page);
+            else
+                for (size_t slot = (size_t)q.cursor; slot < ids.size(); slot++)
+                    if (take(slot)) break;
+        }
+        return page;
+    }
+
+    size_t size() const { return ids.size(); }
+
+    // IDs below `next` are taken (e.g. by archived orders) and not handed out again.
+    void reserveIds(uint64_t next) { nextId = max(nextId, next); }
+
+    // Drops every slot `drop` returns true for. The rest keep their order and
+    // their place in the status lists but move down to lower slots, so older
+    // listing cursors are off afterwards. Returns how many were dropped.
+    template <class Drop>
+    size_t removeIf(Drop drop) {
+        vector<uint32_t> moved(ids.size(), NoLink);
+        size_t kept = 0;
+        for (size_t slot = 0; slot < ids.size(); slot++)
+            if (!drop(slot)) moved[slot] = (uint32_t)kept++;
+        size_t removed = ids.size() - kept;
+        if (!removed) return 0;
+        for (size_t slot = 0; slot < ids.size(); slot++) {
+            size_t to = moved[slot];
+            if (to == NoLink || to == slot) continue;
+            ids[to] = ids[slot];
+            userKeys[to] = userKeys[slot];
+            dishKeys[to] = dishKeys[slot];
+            statuses[to] = statuses[slot];
+            created[to] = created[slot];
+        }
+        ids.resize(kept);
+        userKeys.resize(kept);
+        dishKeys.resize(kept);
+        statuses.resize(kept);
+        created.resize(kept);
+        vector<BucketLink> oldLinks(kept);
+        oldLinks.swap(links);
+        uint32_t oldHead[StatusCount];
+        copy(begin(head), end(head), oldHead);
+        resetBuckets();
+        for (int st = 0; st < StatusCount; st++)
+            for (uint32_t slot = oldHead[st]; slot != NoLink; slot = oldLinks[slot].next)
+                if (moved[slot] != NoLink) link(moved[slot]);
+        slotOfId.clear();
+        sparseSlots.clear();
+        for (auto& slots : slotsByUser) slots.clear();
+        for (size_t slot = 0; slot < kept; slot++) {
+            mapId(ids[slot], slot);
+            slotsByUser[userKeys[slot]].push_back((uint32_t)slot);
+        }
+        return removed;
+    }
+
+    void reserve(size_t n) {
+        ids.reserve(n);
+        userKeys.reserve(n);
+        dishKeys.reserve(n);
+        statuses.reserve(n);
+        created.reserve(n);
+        links.reserve(n);
+    }
+
+    void clear() {
+        ids.clear();
+        userKeys.clear();
+        dishKeys.clear();
+        statuses.clear();
+        created.clear();
+        links.clear();
+        resetBuckets();
+        slotOfId.clear();
+        sparseSlots.clear();
+        slotsByUser.clear();
+        nextId = 1;
+    }
+};
+
+// ==== ORDER JOURNAL ====
+// Append-only log of order changes, one record per line:
+//   C <id> <Order::toString()>\t<checksum>   order created
+//   S <id> <status>\t<checksum>              status changed
+//   A <id> <status>\t<checksum>              moved to the archive (left the live set)
+// Records are idempotent (they carry the order ID and the absolute status),
+// so replaying a journal over a snapshot that already contains it is harmless.
+// A last line without '\n' or with a wrong checksum is a torn write and is cut off.
+// Records are buffered in `pending` until flush(); appended/written count the
+// bytes ever buffered and ever written, so a flush can stop at an earlier mark.
+// onDisk is the size of the file's complete records; a failed flush cuts the
+// file back to it and keeps the records buffered for the next try.
+class OrderJournal {
+    string path;
+    string snapshotPath;
+    bool binary = false; // snapshot Orders.bin formatındadır
+    FILE* out = nullptr;
+    string pending;
+    uint64_t appended = 0;
+    uint64_t written = 0;
+    uint64_t onDisk = 0;
+    size_t bytes = 0;
+    size_t compactThreshold;
+    thread compactor;
+
+    string frozenPath() const { return path + ".old"; }
+
+    void append(const string& payload) {
+        char tail[16];
+        snprintf(tail, sizeof(tail), "\t%08x\n", fnv1a32(payload.data(), payload.size()));
+        pending += payload;
+        pending += tail;
+        bytes += payload.size() + 10;
+        appended += payload.size() + 10;
+    }
+
+    void closeFile() {
+        if (out) fclose(out);
+        out = nullptr;
+    }
+
+    // A short write may have left part of a record in the file (and fclose may
+    // still push more of it); without the cut, the retry would follow a torn
+    // record and replay would drop everything after it.
+    bool rollBack() {
+        closeFile();
+        error_code ec;
+        fs::resize_file(path, onDisk, ec);
+        out = fopen(path.c_str(), "ab");
+        return false;
+    }
+
+    // Records already in the snapshot do not need to be written any more.
+    void dropPending() {
+        pending.clear();
+        written = appended;
+    }
+
+    // Reads one journal file into `orders`. Returns the size of the valid prefix.
+    // Archived orders are dropped together once the file is read.
+    static size_t replayFile(const string& filePath, OrderStore& orders) {
+        ifstream fs(filePath, ios::binary);
+        if (!fs.is_open()) return 0;
+        string data((istreambuf_iterator<char>(fs)), istreambuf_iterator<char>());
+        size_t pos = 0;
+        unordered_set<uint64_t> archived;
+        while (pos < data.size()) {
+            size_t end = data.find('\n', pos);
+            if (end == string::npos) break;                 // torn tail
+            size_t tab = data.rfind('\t', end);
+            if (tab == string::npos || tab < pos || end - tab != 9) break;
+            uint32_t stored = (uint32_t)strtoul(data.substr(tab + 1, 8).c_str(), nullptr, 16);
+            if (stored != fnv1a32(data.data() + pos, tab - pos)) break;
+            if (!applyRecord(data.substr(pos, tab - pos), orders, archived)) break;
+            pos = end + 1;
+        }
+        if (!archived.empty())
+            orders.removeIf([&](size_t slot) { return archived.count(orders.id(slot)) != 0; });
+        return pos;
+    }
+
+    static bool applyRecord(const string& rec, OrderStore& orders, unordered_set<uint64_t>& archived) {
+        if (rec.size() < 4 || rec[1] != ' ') return false;
+        size_t sp = rec.find(' ', 2);
+        if (sp == string::npos) return false;
+        uint64_t id;
+        try { id = stoull(rec.substr(2, sp - 2)); }
+        catch (...) { return false; }
+        string body = rec.substr(sp + 1);
+        try {
+            if (rec[0] == 'C') {
+                Order ord = Order::fromString(body);
+                if (ord.id != id) return false;
+                orders.insert(ord);
+                return true;
+            }
+            if (rec[0] == 'S') {
+                size_t slot = orders.find(id);
+                int st = stoi(body);
+                if (slot == OrderStore::NoSlot || st < Received || st > Cancelled) return false;
+                orders.setStatus(slot, (OrderStatus)st);
+                return true;
+            }
+            if (rec[0] == 'A') {
+                archived.insert(id);
+                return true;
+            }
+        }
+        catch (...) {}
+        return false;
+    }
+
+    void openFresh() {
+        closeFile();
+        out = fopen(path.c_str(), "wb");
+        onDisk = 0;
+        bytes = pending.size();
+    }
+public:
+    OrderJournal(const string& snapshotPath, size_t compactThreshold = 256 * 1024)
+        : path(snapshotPath + ".journal"), snapshotPath(snapshotPath),
+        compactThreshold(compactThreshold) {
+    }
+    OrderJournal(const OrderJournal&) = delete;
+    OrderJournal& operator=(const OrderJournal&) = delete;
+    ~OrderJournal() {
+        flush();
+        closeFile();
+        waitForCompaction();
+    }
+
+    // Points the journal at another snapshot file/format. Call before replay()
+    // or right after checkpoint(), when the journal is empty.
+    void setSnapshot(const string& newSnapshotPath, bool binarySnapshot) {
+        waitForCompaction();
+        bool wasOpen = out != nullptr;
+        if (wasOpen) {
+            closeFile();
+            error_code ec;
+            fs::remove(path, ec);
+        }
+        snapshotPath = newSnapshotPath;
+        path = newSnapshotPath + ".journal";
+        binary = binarySnapshot;
+        if (wasOpen) openFresh();
+    }
+
+    // Applies the frozen and the live journal on top of the snapshot already in `orders`.
+    void replay(OrderStore& orders) {
+        bool hadFrozen = fs::exists(frozenPath());
+        if (hadFrozen) replayFile(frozenPath(), orders);
+        size_t good = replayFile(path, orders);
+        error_code ec;
+        if (fs::exists(path) && fs::file_size(path, ec) != good) {
+            fs::resize_file(path, good, ec);
+            cout << "Order journal: dropped a torn record.\n";
+        }
+        if (hadFrozen) {
+            // Bir əvvəlki kompaksiya yarımçıq qalıb: indi bitiririk.
+            writeSnapshot(orders);
+            fs::remove(frozenPath(), ec);
+            openFresh();
+            return;
+        }
+        out = fopen(path.c_str(), "ab");
+        onDisk = good;
+        bytes = good;
+    }
+
+    void appendCreate(const OrderStore& orders, size_t slot) {
+        string rec = "C " + to_string(orders.id(slot)) + " ";
+        orders.appendRow(slot, rec);
+        rec.pop_back();
+        append(rec);
+    }
+
+    void appendStatus(const OrderStore& orders, size_t slot) {
+        append("S " + to_string(orders.id(slot)) + " " + to_string((int)orders.status(slot)));
+    }
+
+    void appendArchived(const Order& order) {
+        append("A " + to_string(order.id) + " " + to_string((int)order.status));
+    }
+
+    uint64_t appendedBytes() const noexcept { return appended; }
+
+    // Makes room for `records` more status records, so buffering them does not
+    // reallocate: "S <id, up to 20 digits> <status>\t<8 hex digits>\n".
+    void reserveStatusRecords(size_t records) {
+        pending.reserve(pending.size() + records * 34);
+    }
+
+    // Writes the buffered records up to `mark` (default: all of them);
+    // durable = true also fsyncs the journal. Returns false on a write error.
+    bool flush(bool durable = false, uint64_t mark = UINT64_MAX) {
+        STATS_TIME(StatJournalFlush);
+        size_t count = (size_t)min<uint64_t>(pending.size(), mark > written ? mark - written : 0);
+        if (!out) return count == 0;
+        if (count > 0 && fwrite(pending.data(), 1, count, out) != count) return rollBack();
+        if (!(durable ? syncFile(out) : fflush(out) == 0)) return rollBack();
+        if (count > 0) {
+            pending.erase(0, count);
+            written += count;
+            onDisk += count;
+            STATS_COUNT(CounterBytesWritten, count);
+        }
+        return true;
+    }
+
+    // Once the journal grows past the threshold, it is frozen and a fresh one is
+    // started; a background thread then folds the frozen part into a new snapshot.
+    void compactIfNeeded(const OrderStore& orders) {
+        if (bytes < compactThreshold) return;
+        waitForCompaction();
+        // Buferdəki qeydlər təzə jurnala yazılacaq; snapshot onsuz da onları ehtiva edir.
+        closeFile();
+        error_code ec;
+        fs::rename(path, frozenPath(), ec);
+        if (ec) { out = fopen(path.c_str(), "ab"); return; }
+        openFresh();
+        compactor = thread([content = render(orders), snapshot = snapshotPath, frozen = frozenPath()]() {
+            try {
+                writeFileAtomically(snapshot, content);
+                error_code ec;
+                fs::remove(frozen, ec);
+            }
+            catch (...) {} // frozen journal stays and is replayed on the next start
+        });
+    }
+
+    void waitForCompaction() {
+        if (compactor.joinable()) compactor.join();
+    }
+
+    // Compaction in steps, for the persister's flusher (no compactor thread):
+    // freeze the journal and render the snapshot now, write it with the other
+    // files of the round, then drop the frozen journal.
+    bool wantsCompaction() const noexcept { return bytes >= compactThreshold; }
+    const string& snapshotFile() const noexcept { return snapshotPath; }
+
+    bool beginCompaction(const OrderStore& orders, string& snapshot) {
+        waitForCompaction();
+        closeFile();
+        error_code ec;
+        fs::rename(path, frozenPath(), ec);
+        if (ec) { out = fopen(path.c_str(), "ab"); return false; }
+        openFresh();
+        snapshot = render(orders);
+        return true;
+    }
+
+    void finishCompaction() {
+        error_code ec;
+        fs::remove(frozenPath(), ec);
+    }
+
+    // Writes a full snapshot and empties the journal (used on shutdown).
+    void checkpoint(const OrderStore& orders) {
+        waitForCompaction();
+        closeFile();
+        dropPending();
+        writeSnapshot(orders);
+        error_code ec;
+        fs::remove(frozenPath(), ec);
+        openFresh();
+    }
+
+    static string renderSnapshot(const OrderStore& orders) {
+        string content;
+        content.reserve(orders.size() * 32);
+        for (size_t slot = 0; slot < orders.size(); slot++)
+            orders.appendRow(slot, content);
+        return content;
+    }
+
+    static string renderBinarySnapshot(const OrderStore& orders) {
+        SnapshotWriter writer;
+        for (size_t slot = 0; slot < orders.size(); slot++) {
+            OrderSnapshotRecord rec{};
+            rec.id = orders.id(slot);
+            rec.userId = writer.addString(orders.userId(slot));
+            rec.dishName = writer.addString(orders.dishName(slot));
+            rec.status = (uint32_t)orders.status(slot);
+            rec.createdAt = orders.createdAt(slot);
+            writer.addRecord(rec);
+        }
+        return writer.finish(SnapshotOrders, sizeof(OrderSnapshotRecord));
+    }
+
+    string render(const OrderStore& orders) const {
+        return binary ? renderBinarySnapshot(orders) : renderSnapshot(orders);
+    }
+
+    void writeSnapshot(const OrderStore& orders) const {
+        writeFileAtomically(snapshotPath, render(orders));
+    }
+};
+
+// ==== ORDER ARCHIVE ====
+// Finished orders (Ready, Cancelled) leave the live OrderStore for immutable
+// segment files in <data dir>/Archive/, one per archive run, named by the
+// time they were written (orders-20261017-142530-001.seg). Layout:
+//   blocks | user table | dish table | pad to 8 | ArchiveBlockIndex[] | ArchiveFooter
+// Orders are sorted by creation time and cut into blocks of 256. In a block
+// each order is five fields: varint createdAt delta, zigzag varint ID delta,
+// varint user and dish numbers into the segment's tables, status byte. The
+// block index (time range and checksum of each block) and the per-user block
+// lists in the user table are the sparse index: a lookup decodes only the
+// blocks that can match. Segments are mapped, so the blocks a lookup skips
+// are never read.
+struct ArchiveBlockIndex {
+    uint64_t offset;
+    uint32_t size;
+    uint32_t count;
+    uint32_t firstCreated;
+    uint32_t lastCreated;
+    uint32_t checksum;
+    uint32_t pad;
+};
+
+struct ArchiveFooter {
+    char magic[8];          // "FPARCH\0\0"
+    uint32_t version;
+    uint32_t blockCount;
+    uint64_t orderCount;
+    uint64_t tablesOffset;
+    uint64_t indexOffset;
+    uint64_t maxId;
+    uint32_t minCreated;
+    uint32_t maxCreated;
+    uint32_t checksum;      // user/dish tables and block index
+    uint32_t endianTag;     // 0x01020304 in the writer's byte order
+};
+
+static const uint32_t archiveVersion = 1;
+
+static void putVarint(string& out, uint64_t value) {
+    while (value >= 0x80) {
+        out += (char)(value | 0x80);
+        value >>= 7;
+    }
+    out += (char)value;
+}
+
+static bool getVarint(const char*& p, const char* end, uint64_t& value) {
+    value = 0;
+    for (int shift = 0; p < end && shift < 64; shift += 7) {
+        uint8_t byte = (uint8_t)*p++;
+        value |= (uint64_t)(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) return true;
+    }
+    return false;
+}
+
+// Filter of an archive lookup. Results come newest first.
+struct ArchiveQuery {
+    string userId;              // empty: any user
+    uint32_t from = 0;          // createdAt range, both ends included
+    uint32_t to = UINT32_MAX;
+    size_t limit = 50;
+};
+
+class ArchiveSegment {
+    MappedFile file;
+    const ArchiveFooter* footer = nullptr;
+    const ArchiveBlockIndex* blocks = nullptr;
+    vector<string_view> users, dishes;
+    vector<const char*> userBlocks;     // per user: its block list in the user table
+    unordered_map<string_view, uint32_t> userByName;
+    const char* tablesEnd = nullptr;
+
+    static bool readName(const char*& p, const char* end, string_view& name) {
+        uint64_t len;
+        if (!getVarint(p, end, len) || len > (uint64_t)(end - p)) return false;
+        name = string_view(p, (size_t)len);
+        p += len;
+        return true;
+    }
+public:
+    static constexpr uint32_t BlockOrders = 256;
+
+    // Encodes the orders as a segment; sorts `finished` by creation time.
+    static string render(vector<Order>& finished) {
+        sort(finished.begin(), finished.end(), [](const Order& a, const Order& b) {
+            return a.createdAt != b.createdAt ? a.createdAt < b.createdAt : a.id < b.id;
+        });
+        unordered_map<string_view, uint32_t> userNums, dishNums;
+        vector<string_view> userNames, dishNames;
+        vector<vector<uint32_t>> blocksOfUser;
+        vector<ArchiveBlockIndex> index;
+        ArchiveFooter footer{};
+        string out;
+        out.reserve(finished.size() * 8 + 64);
+        uint64_t prevId = 0;
+        uint32_t prevCreated = 0;
+        auto closeBlock = [&]() {
+            ArchiveBlockIndex& b = index.back();
+            b.size = (uint32_t)(out.size() - b.offset);
+            b.checksum = fnv1a32(out.data() + b.offset, b.size);
+        };
+        for (size_t i = 0; i < finished.size(); i++) {
+            const Order& ord = finished[i];
+            if (i % BlockOrders == 0) {
+                if (!index.empty()) closeBlock();
+                ArchiveBlockIndex b{};
+                b.offset = out.size();
+                b.firstCreated = ord.createdAt;
+                index.push_back(b);
+                prevCreated = ord.createdAt;
+                prevId = 0;
+            }
+            uint32_t block = (uint32_t)(index.size() - 1);
+            auto user = userNums.emplace(ord.userId, (uint32_t)userNames.size());
+            if (user.second) {
+                userNames.push_back(ord.userId);
+                blocksOfUser.emplace_back();
+            }
+            vector<uint32_t>& list = blocksOfUser[user.first->second];
+            if (list.empty() || list.back() != block) list.push_back(block);
+            auto dish = dishNums.emplace(ord.dishName, (uint32_t)dishNames.size());
+            if (dish.second) dishNames.push_back(ord.dishName);
+            int64_t idDelta = (int64_t)(ord.id - prevId);
+            putVarint(out, ord.createdAt - prevCreated);
+            putVarint(out, ((uint64_t)idDelta << 1) ^ (uint64_t)(idDelta >> 63));
+            putVarint(out, user.first->second);
+            putVarint(out, dish.first->second);
+            out += (char)ord.status;
+            prevCreated = ord.createdAt;
+            prevId = ord.id;
+            index.back().count++;
+            index.back().lastCreated = ord.createdAt;
+            footer.maxId = max(footer.maxId, ord.id);
+        }
+        if (!index.empty()) closeBlock();
+
+        footer.tablesOffset = out.size();
+        putVarint(out, userNames.size());
+        for (size_t u = 0; u < userNames.size(); u++) {
+            putVarint(out, userNames[u].size());
+            out += userNames[u];
+            putVarint(out, blocksOfUser[u].size());
+            uint32_t prev = 0;
+            for (uint32_t block : blocksOfUser[u]) {
+                putVarint(out, block - prev);
+                prev = block;
+            }
+        }
+        putVarint(out, dishNames.size());
+        for (string_view name : dishNames) {
+            putVarint(out, name.size());
+            out += name;
+        }
+        out.resize((out.size() + 7) & ~(size_t)7, '\0');
+        footer.indexOffset = out.size();
+        out.append((const char*)index.data(), index.size() * sizeof(ArchiveBlockIndex));
+
+        memcpy(footer.magic, "FPARCH\0\0", 8);
+        footer.version = archiveVersion;
+        footer.blockCount = (uint32_t)index.size();
+        footer.orderCount = finished.size();
+        footer.minCreated = finished.empty() ? 0 : finished.front().createdAt;
+        footer.maxCreated = finished.empty() ? 0 : finished.back().createdAt;
+        footer.checksum = fnv1a32(out.data() + footer.tablesOffset, out.size() - footer.tablesOffset);
+        footer.endianTag = 0x01020304;
+        out.append((const char*)&footer, sizeof(footer));
+        return out;
+    }
+
+    // Maps a segment and reads its tables. Returns "" on success or the reason it was rejected.
+    string open(const string& path) {
+        footer = nullptr;
+        users.clear();
+        dishes.clear();
+        userBlocks.clear();
+        userByName.clear();
+        if (!file.open(path)) return "cannot map file";
+        if (file.size() < sizeof(ArchiveFooter) || file.size() % 8) return "bad size";
+        const char* base = file.data();
+        const ArchiveFooter* f = (const ArchiveFooter*)(base + file.size() - sizeof(ArchiveFooter));
+        if (memcmp(f->magic, "FPARCH\0\0", 8) != 0) return "not an archive segment";
+        if (f->endianTag != 0x01020304) return "written on a different byte order";
+        if (f->version != archiveVersion) return "unsupported version " + to_string(f->version);
+        if (f->tablesOffset > f->indexOffset || f->indexOffset % 8
+            || f->indexOffset + (uint64_t)f->blockCount * sizeof(ArchiveBlockIndex) + sizeof(ArchiveFooter) != file.size())
+            return "size mismatch";
+        if (fnv1a32(base + f->tablesOffset, file.size() - sizeof(ArchiveFooter) - f->tablesOffset) != f->checksum)
+            return "checksum mismatch";
+        const char* p = base + f->tablesOffset;
+        const char* end = base + f->indexOffset;
+        uint64_t count, blockCount, delta;
+        string_view name;
+        if (!getVarint(p, end, count)) return "bad user table";
+        for (uint64_t i = 0; i < count; i++) {
+            if (!readName(p, end, name)) return "bad user table";
+            userByName.emplace(name, (uint32_t)users.size());
+            users.push_back(name);
+            userBlocks.push_back(p);
+            if (!getVarint(p, end, blockCount)) return "bad user table";
+            for (uint64_t b = 0; b < blockCount; b++)
+                if (!getVarint(p, end, delta)) return "bad user table";
+        }
+        if (!getVarint(p, end, count)) return "bad dish table";
+        for (uint64_t i = 0; i < count; i++) {
+            if (!readName(p, end, name)) return "bad dish table";
+            dishes.push_back(name);
+        }
+        footer = f;
+        blocks = (const ArchiveBlockIndex*)end;
+        tablesEnd = p;
+        return "";
+    }
+
+    uint64_t orderCount() const noexcept { return footer ? footer->orderCount : 0; }
+    uint64_t maxId() const noexcept { return footer ? footer->maxId : 0; }
+    size_t bytes() const noexcept { return file.size(); }
+    const ArchiveBlockIndex& block(uint32_t b) const { return blocks[b]; }
+
+    // Blocks that can hold orders matching q, oldest first.
+    vector<uint32_t> candidates(const ArchiveQuery& q) const {
+        vector<uint32_t> list;
+        if (!footer || footer->maxCreated < q.from || footer->minCreated > q.to) return list;
+        auto inRange = [&](uint64_t b) {
+            return b < footer->blockCount && blocks[b].lastCreated >= q.from && blocks[b].firstCreated <= q.to;
+        };
+        if (q.userId.empty()) {
+            for (uint32_t b = 0; b < footer->blockCount; b++)
+                if (inRange(b)) list.push_back(b);
+            return list;
+        }
+        auto user = userByName.find(q.userId);
+        if (user == userByName.end()) return list;
+        const char* p = userBlocks[user->second];
+        uint64_t count, delta, block = 0;
+        getVarint(p, tablesEnd, count);
+        for (uint64_t i = 0; i < count && getVarint(p, tablesEnd, delta); i++) {
+            block += delta;
+            if (inRange(block)) list.push_back((uint32_t)block);
+        }
+        return list;
+    }
+
+    // Decodes block b and calls f(Order&&) for its orders that match q.
+    // Returns false if the block is damaged.
+    template <class F>
+    bool decode(uint32_t b, const ArchiveQuery& q, F f) const {
+        const ArchiveBlockIndex& bi = blocks[b];
+        if (bi.offset + bi.size > footer->tablesOffset) return false;
+        const char* p = file.data() + bi.offset;
+        const char* end = p + bi.size;
+        if (fnv1a32(p, bi.size) != bi.checksum) return false;
+        uint64_t created = bi.firstCreated, id = 0;
+        for (uint32_t i = 0; i < bi.count; i++) {
+            uint64_t createdDelta, idDelta, user, dish;
+            if (!getVarint(p, end, createdDelta) || !getVarint(p, end, idDelta) || !getVarint(p, end, user)
+                || !getVarint(p, end, dish) || p == end) return false;
+            uint8_t st = (uint8_t)*p++;
+            created += createdDelta;
+            id += (idDelta >> 1) ^ (0 - (idDelta & 1));
+            if (user >= users.size() || dish >= dishes.size() || st > Cancelled) return false;
+            if (created < q.from || created > q.to) continue;
+            if (!q.userId.empty() && users[user] != q.userId) continue;
+            f(Order(id, string(users[user]), string(dishes[dish]), st, (uint32_t)created));
+        }
+        return true;
+    }
+};
+
+// The Archive/ directory of one data directory. Segments are only ever
+// added, so each is opened once (mapped, tables read) and kept for later
+// lookups; the directory is listed on first use.
+class OrderArchive {
+    string dir;     // ends with '/'
+    struct OpenSegment {
+        string path;
+        unique_ptr<ArchiveSegment> segment;     // null if it could not be opened
+    };
+    mutable mutex segmentsMutex;
+    mutable vector<OpenSegment> segments;       // oldest first
+    mutable bool listed = false;
+
+    void addSegment(const string& path) const {
+        auto seg = make_unique<ArchiveSegment>();
+        string error = seg->open(path);
+        if (!error.empty()) {
+            cout << "Archive: skipped " << path << " (" << error << ").\n";
+            seg.reset();
+        }
+        segments.push_back({ path, move(seg) });
+    }
+
+    // Caller holds segmentsMutex.
+    void listSegments() const {
+        if (listed) return;
+        listed = true;
+        for (const string& path : segmentPaths()) addSegment(path);
+    }
+public:
+    explicit OrderArchive(const string& dataDir) : dir(dataDir + "Archive/") {}
+
+    // Segment files, oldest first (the names sort by the time they were written).
+    vector<string> segmentPaths() const {
+        vector<string> paths;
+        error_code ec;
+        for (fs::directory_iterator it(dir, ec), end; !ec && it != end; it.increment(ec))
+            if (it->path().extension() == ".seg") paths.push_back(it->path().string());
+        sort(paths.begin(), paths.end());
+        return paths;
+    }
+
+    // Writes the orders to a new segment and fsyncs it; throws on failure.
+    // `finished` comes back sorted by creation time.
+    string append(vector<Order>& finished) {
+        error_code ec;
+        fs::create_directories(dir, ec);
+        if (ec) throw string("Cannot create " + dir);
+        char stamp[32] = "00000000-000000";
+        tm local{};
+        if (toLocalTime(time(nullptr), local)) strftime(stamp, sizeof(stamp), "%Y%m%d-%H%M%S", &local);
+        string path;
+        for (int n = 1; path.empty() || fs::exists(path); n++) {
+            char name[64];
+            snprintf(name, sizeof(name), "orders-%s-%03d.seg", stamp, n);
+            path = dir + name;
+        }
+        writeFileAtomically(path, ArchiveSegment::render(finished), true);
+        lock_guard<mutex> lock(segmentsMutex);
+        if (listed) addSegment(path);
+        return path;
+    }
+
+    struct Summary {
+        size_t segments = 0;
+        uint64_t orders = 0;
+        uint64_t bytes = 0;
+        uint64_t maxId = 0;
+    };
+
+    Summary summary() const {
+        lock_guard<mutex> lock(segmentsMutex);
+        listSegments();
+        Summary sum;
+        for (const OpenSegment& s : segments) {
+            if (!s.segment) continue;
+            sum.segments++;
+            sum.orders += s.segment->orderCount();
+            sum.bytes += s.segment->bytes();
+            sum.maxId = max(sum.maxId, s.segment->maxId());
+        }
+        return sum;
+    }
+
+    // Up to q.limit matching orders, newest first. An order archived twice
+    // (a crash between writing its segment and journaling the move) is listed once.
+    vector<Order> query(const ArchiveQuery& q) const {
+        auto newer = [](const Order& a, const Order& b) {
+            return a.createdAt != b.createdAt ? a.createdAt > b.createdAt : a.id > b.id;
+        };
+        vector<Order> best;     // heap, the oldest kept order on top
+        unordered_set<uint64_t> seen;
+        if (q.limit == 0) return best;
+        lock_guard<mutex> lock(segmentsMutex);
+        listSegments();
+        for (auto s = segments.rbegin(); s != segments.rend(); ++s) {
+            if (!s->segment) continue;
+            const ArchiveSegment& seg = *s->segment;
+            vector<uint32_t> blocks = seg.candidates(q);
+            for (size_t i = blocks.size(); i-- > 0;) {
+                // Bloklar zamana görə sıralıdır: doluysa, daha köhnələr heç nə vermir.
+                if (best.size() >= q.limit && seg.block(blocks[i]).lastCreated < best.front().createdAt) break;
+                bool ok = seg.decode(blocks[i], q, [&](Order&& ord) {
+                    if (best.size() >= q.limit && !newer(ord, best.front())) return;
+                    // Təkrar nüsxə yığında yer tutmasın.
+                    if (!seen.insert(ord.id).second) return;
+                    best.push_back(move(ord));
+                    push_heap(best.begin(), best.end(), newer);
+                    if (best.size() > q.limit) {
+                        pop_heap(best.begin(), best.end(), newer);
+                        best.pop_back();
+                    }
+                });
+                if (!ok) cout << "Archive: skipped a damaged block in " << s->path << ".\n";
+            }
+        }
+        sort_heap(best.begin(), best.end(), newer);
+        return best;
+    }
+};
+
+// ==== ORDER MANAGER ====
+class OrderManager {
+    OrderStore orders;
+    vector<Dish>* dishesRef = nullptr;
+    vector<shared_ptr<const Recipe>> recipes;    // dishesRef ilə eyni sıra
+    vector<size_t> menuSlotByDish;               // dish key -> recipes index, NoSlot if not on the menu
+    // Reservation ledger: Received orders and the recipe they reserved.
+    // The ledger keeps its own recipe, so menu edits do not change what is released.
+    unordered_map<uint64_t, shared_ptr<const Recipe>> reservations;
+    Stock& stock;
+    string dir;          // data directory ("" = current), ends with '/'
+    OrderJournal journal;
+    OrderArchive archive;   // finished orders moved out of `orders`
+    // KitchenEngine işləyərkən stok, ehtiyat jurnalı və sifariş statuslarını qoruyur.
+    mutex kitchenMutex;
+    Persister* persister = nullptr;
+    size_t persistSlot = 0;
+    // Pre-rendered menu texts (see MenuView); cleared by compileMenu() on every menu change.
+    mutable string menuCache[3];
+    mutable bool menuCached[3] = {};
+    // Servings each menu dish can still be made from unreserved stock (recipes order).
+    // dishesBySlot is the reverse index stock slot -> menu dishes using it, so a
+    // stock change only recomputes the dishes of the slots it touched.
+    vector<uint32_t> servings;
+    vector<vector<uint32_t>> dishesBySlot;
+    size_t availabilitySlots = 0;   // stock.slotCount() the index was built for
+
+    // Called after records were added to the journal: writes them now, or
+    // leaves them to the persister's next round.
+    void journalChanged() {
+        if (persister) {
+            persister->markDirty(persistSlot);
+            return;
+        }
+        journal.flush();
+        journal.compactIfNeeded(orders);
+    }
+
+    const shared_ptr<const Recipe>& recipeAt(size_t menuSlot) {
+        auto& recipe = recipes[menuSlot];
+        // Stoka yeni ingredient gəlibsə, çatışmayanı yenidən axtarırıq.
+        if (!recipe->missing.empty() && recipe->stockSlots != stock.slotCount())
+            recipe = make_shared<const Recipe>(stock.compile((*dishesRef)[menuSlot]));
+        return recipe;
+    }
+
+    // Finds the compiled recipe of a dish key; nullptr if the dish is not on the menu.
+    shared_ptr<const Recipe> recipeFor(uint32_t dishKey) {
+        if (dishKey >= menuSlotByDish.size() || menuSlotByDish[dishKey] == OrderStore::NoSlot) return nullptr;
+        return recipeAt(menuSlotByDish[dishKey]);
+    }
+
+    void updateServings(size_t menuSlot) {
+        uint32_t now = stock.servings(*recipes[menuSlot]);
+        // Only a sold-out flip changes the order screen text.
+        if ((now == 0) != (servings[menuSlot] == 0)) menuCached[MenuIndexed] = false;
+        servings[menuSlot] = now;
+    }
+
+    // Brings `servings` up to date with the stock changes since the last call.
+    // Normally only the dishes of the touched slots are recomputed; a new
+    // ingredient or a reload rebuilds the reverse index and everything.
+    void refreshAvailability() {
+        bool partial = stock.forEachChangedSlot([&](uint32_t slot) {
+            if (slot >= dishesBySlot.size()) return;
+            for (uint32_t menuSlot : dishesBySlot[slot]) updateServings(menuSlot);
+        });
+        if (partial && availabilitySlots == stock.slotCount()) return;
+        availabilitySlots = stock.slotCount();
+        for (auto& dishes : dishesBySlot) dishes.clear();
+        dishesBySlot.resize(availabilitySlots);
+        for (size_t i = 0; i < recipes.size(); i++) {
+            for (const RecipeLine& line : recipeAt(i)->lines)
+                if (dishesBySlot[line.slot].empty() || dishesBySlot[line.slot].back() != i)
+                    dishesBySlot[line.slot].push_back((uint32_t)i);
+            updateServings(i);
+        }
+    }
+
+    // Re-reserves the Received orders after startup (reservations are not persisted).
+    // Orders the current stock cannot cover stay unreserved and are checked when advanced.
+    void rebuildReservations() {
+        reservations.clear();
+        stock.clearReservations();
+        orders.forEachInStatus(Received, [&](size_t slot) {
+            auto recipe = recipeFor(orders.dishKey(slot));
+            if (!recipe || !recipe->missing.empty() || stock.reserve(*recipe) >= 0) return true;
+            reservations.emplace(orders.id(slot), recipe);
+            return true;
+        });
+    }
+public:
+    static string statusToString(OrderStatus st) {
+        switch (st) {
+        case Received: return "Received";
+        case Preparing: return "Preparing";
+        case Cooking: return "Cooking";
+        case Packed: return "Packed";
+        case Ready: return "Ready";
+        case Cancelled: return "Cancelled";
         default: return "?";
         }
     }
-public:
-    OrderManager() {
-        loadOrders();
+
+    struct AdvanceResult {
+        uint64_t orderId;
+        bool ok;
+        string message; // yeni status və ya xəta
+    };
+
+    enum MenuView {
+        MenuIndexed, // order screen: index, name, price
+        MenuDetails, // every field of every dish
+        MenuAdmin    // MenuDetails with the admin panel's separators
+    };
+
+    // checkpoint() archives the finished orders once there are this many.
+    static constexpr size_t AutoArchiveAt = 10000;
+
+    explicit OrderManager(Stock& stock, string dataDir = "")
+        : stock(stock), dir(move(dataDir)), journal(dir + "Orders.txt"), archive(dir) {
+        if (fs::exists(dir + "Orders.bin")) {
+            journal.setSnapshot(dir + "Orders.bin", true);
+            if (!loadOrdersSnapshot(dir + "Orders.bin")) loadOrders(dir + "Orders.txt");
+        }
+        else loadOrders(dir + "Orders.txt");
+        journal.replay(orders);
+        orders.reserveIds(archive.summary().maxId + 1);
+    }
+
+    // Journal records (and compaction snapshots) are then written by the flusher,
+    // after the files of the stores registered before this one (register the
+    // Stock first), so they never get ahead of the stock they depend on.
+    void setPersister(Persister* p) {
+        persister = p;
+        persistSlot = p->addStore([this](vector<FileWrite>& writes) {
+            string snapshot;
+            if (journal.wantsCompaction() && journal.beginCompaction(orders, snapshot)) {
+                writes.emplace_back(journal.snapshotFile(), move(snapshot));
+                writes.emplace_back("the frozen order journal", [this](bool) {
+                    journal.finishCompaction();
+                    return true;
+                });
+            }
+            uint64_t mark = journal.appendedBytes();
+            writes.emplace_back("the order journal", [this, mark](bool durable) { return journal.flush(durable, mark); });
+        });
+    }
+
+    // Writes a full orders snapshot and empties the journal (on shutdown).
+    // A large finished backlog is archived first.
+    void checkpoint() {
+        auto data = Persister::lockData(persister);
+        if (orders.countInStatus(Ready) + orders.countInStatus(Cancelled) >= AutoArchiveAt) {
+            try { archiveFinished(); }
+            catch (const string& ex) { cout << ex << endl; }
+        }
+        journal.checkpoint(orders);
+    }
+
+    // Pre-sizes the journal buffer for `advances` status changes.
+    void reserveJournal(size_t advances) {
+        auto data = Persister::lockData(persister);
+        journal.reserveStatusRecords(advances);
+    }
+
+    // Moves the Ready and Cancelled orders to a new archive segment and drops
+    // them from the live set. The segment is on disk before the journal
+    // records the move, so a crash in between only leaves them in both places.
+    // Returns how many orders moved.
+    size_t archiveFinished() {
+        auto data = Persister::lockData(persister);
+        vector<Order> finished;
+        finished.reserve(orders.countInStatus(Ready) + orders.countInStatus(Cancelled));
+        for (OrderStatus st : { Ready, Cancelled })
+            orders.forEachInStatus(st, [&](size_t slot) {
+                finished.push_back(orders.get(slot));
+                return true;
+            });
+        if (finished.empty()) return 0;
+        archive.append(finished);
+        for (const Order& ord : finished) journal.appendArchived(ord);
+        orders.removeIf([&](size_t slot) { return orders.status(slot) >= Ready; });
+        journalChanged();
+        return finished.size();
+    }
+
+    // Archived orders matching the query, newest first (live orders not included).
+    vector<Order> orderHistory(const ArchiveQuery& query) const { return archive.query(query); }
+
+    OrderArchive::Summary archiveSummary() const { return archive.summary(); }
+
+    size_t liveOrderCount() const { return orders.size(); }
+
+    void bindDishList(vector<Dish>* dishes) {
+        dishesRef = dishes;
+        compileMenu();
+        rebuildReservations();
+    }
+
+    // Resolves every dish to stock slots. Called whenever the menu changes.
+    void compileMenu() {
+        recipes.clear();
+        fill(menuSlotByDish.begin(), menuSlotByDish.end(), OrderStore::NoSlot);
+        for (bool& cached : menuCached) cached = false;
+        availabilitySlots = SIZE_MAX;   // reverse index is rebuilt on the next refresh
+        if (!dishesRef) return;
+        recipes.reserve(dishesRef->size());
+        for (size_t i = 0; i < dishesRef->size(); i++) {
+            recipes.push_back(make_shared<const Recipe>(stock.compile((*dishesRef)[i])));
+            uint32_t key = orders.internDish((*dishesRef)[i].getName());
+            if (key >= menuSlotByDish.size()) menuSlotByDish.resize(key + 1, OrderStore::NoSlot);
+            menuSlotByDish[key] = i;
+        }
+        servings.assign(recipes.size(), 0);
+        refreshAvailability();
+    }
+
+    int getDishCount() const {
+        return dishesRef ? dishesRef->size() : 0;
+    }
+
+    string getDishNameByIndex(int index) const {
+        if (!dishesRef) throw string("Dish list is not loaded!");
+        if (index < 0 || (size_t)index >= dishesRef->size())
+            throw string("Invalid dish index!");
+        return (*dishesRef)[index].getName();
+    }
+
+    // Rendered once per menu change; later calls return the same buffer.
+    const string& menuText(MenuView view) const {
+        string& text = menuCache[view];
+        if (menuCached[view]) return text;
+        text.clear();
+        if (view == MenuIndexed) text += "\n===== MENU =====\n";
+        for (size_t i = 0; dishesRef && i < dishesRef->size(); i++) {
+            const Dish& d = (*dishesRef)[i];
+            if (view == MenuIndexed) {
+                text += to_string(i) + ") " + d.getName() + "  Price: ";
+                appendNumber(text, d.getPrice());
+                if (i < servings.size() && servings[i] == 0) text += "  [SOLD OUT]";
+                text += "\n";
+                continue;
+            }
+            if (view == MenuAdmin) text += "-----------------------------------------------\n";
+            d.render(text);
+            text += view == MenuAdmin ? "-----------------------------------------------\n" : "------------------------\n";
+        }
+        if (view == MenuIndexed) text += "================\n";
+        menuCached[view] = true;
+        return text;
+    }
+
+    void showAllDishes() const {
+        if (!dishesRef) { cout << "Dish list not loaded!\n"; return; }
+        writeBlock(cout, menuText(MenuDetails));
+    }
+
+    void showAllDishesWithIndex() {
+        if (!dishesRef) { cout << "Dish list not loaded!\n"; return; }
+        auto data = Persister::lockData(persister);
+        refreshAvailability();
+        writeBlock(cout, menuText(MenuIndexed));
+    }
+
+    // Servings of the index-th menu dish that free stock still covers (0 = sold out).
+    uint32_t servingsAvailable(size_t index) {
+        auto data = Persister::lockData(persister);
+        refreshAvailability();
+        return index < servings.size() ? servings[index] : 0;
+    }
+
+    // Reserves the dish's ingredients up front; throws if they are not available,
+    // so an accepted order can always move to Preparing.
+    uint64_t createOrder(const string& userId, const string& dishName) {
+        STATS_TIME(StatCreateOrder);
+        auto data = Persister::lockData(persister);
+        uint32_t dishKey = orders.findDish(dishName);
+        auto recipe = recipeFor(dishKey);
+        if (!recipe) throw string("Dish does not exist in the menu!");
+        if (!recipe->missing.empty())
+            throw string("Ingredient not found in stock: " + recipe->missing);
+        refreshAvailability();
+        if (servings[menuSlotByDish[dishKey]] == 0) throw string("Dish is sold out: " + dishName);
+        long shortLine = stock.reserve(*recipe);
+        if (shortLine >= 0)
+            throw string("Not enough ingredient in stock: " + stock.slotName(recipe->lines[shortLine].slot));
+        size_t slot = orders.add(userId, dishName, (uint32_t)time(nullptr));
+        uint64_t id = orders.id(slot);
+        reservations.emplace(id, recipe);
+        journal.appendCreate(orders, slot);
+        journalChanged();
+        return id;
+    }
+
+    void moveOrderForward(uint64_t orderId) {
+        STATS_TIME(StatMoveForward);
+        auto data = Persister::lockData(persister);
+        size_t slot = orders.find(orderId);
+        if (slot == OrderStore::NoSlot) {
+            cout << "Order not found!\n";
+            return;
+        }
+        OrderStatus status = orders.status(slot);
+        if (status == Cancelled) {
+            cout << "Order was cancelled!\n";
+            return;
+        }
+        // DƏYİŞİKLİK: Stock RECEIVED-də azaldılsın
+        if (status == Received) {
+            auto reserved = reservations.find(orderId);
+            if (reserved != reservations.end()) {
+                stock.commitReservation(*reserved->second);
+                reservations.erase(reserved);
+                stock.saveStorage();
+                cout << "Stock updated for dish: " << orders.dishName(slot) << endl;
+            }
+            else {
+                // Ehtiyatsız sifariş (məs. yükləmədə reseptı tapılmayıb): köhnə yol.
+                if (!dishesRef) {
+                    cout << "Dish list is not loaded!\n";
+                    return;
+                }
+                auto recipe = recipeFor(orders.dishKey(slot));
+                if (!recipe) {
+                    cout << "Dish does not exist in the menu!\n";
+                    return;
+                }
+                long shortLine = stock.useRecipe(*recipe, orders.dishName(slot));
+                if (shortLine != -1) {
+                    if (shortLine == Stock::RecipeMissing)
+                        cout << "Ingredient not found in stock: " << recipe->missing << endl;
+                    else
+                        cout << "Not enough ingredient in stock: " << stock.slotName(recipe->lines[shortLine].slot) << endl;
+                    cout << "Order cannot move to Preparing stage!\n";
+                    return;
+                }
+            }
+        }
+        if (status < Ready)
+            status = (OrderStatus)(status + 1);
+        orders.setStatus(slot, status);
+        journal.appendStatus(orders, slot);
+        journalChanged();
+        if (status == Ready)
+            cout << "Order is ready for pickup!\n";
+        else
+            cout << "Order progressed to status: " << statusToString(status) << endl;
+    }
+
+    // Cancels a Received order and releases its reservation. With a non-empty
+    // userId only that user's orders can be cancelled.
+    void cancelOrder(uint64_t orderId, const string& userId = "") {
+        auto data = Persister::lockData(persister);
+        size_t slot = orders.find(orderId);
+        if (slot == OrderStore::NoSlot || (!userId.empty() && orders.userKey(slot) != orders.findUser(userId))) {
+            cout << "Order not found!\n";
+            return;
+        }
+        if (orders.status(slot) != Received) {
+            cout << "Only orders in Received status can be cancelled.\n";
+            return;
+        }
+        auto reserved = reservations.find(orderId);
+        if (reserved != reservations.end()) {
+            stock.release(*reserved->second);
+            reservations.erase(reserved);
+        }
+        orders.setStatus(slot, Cancelled);
+        journal.appendStatus(orders, slot);
+        journalChanged();
+        cout << "Order #" << orderId << " cancelled.\n";
+    }
+
+    // Advances a set of orders together. Received orders with a reservation are
+    // committed as one summed demand; the demand of unreserved ones is summed and
+    // checked against free stock in one pass, and if it does not fit they are
+    // admitted in the given order while stock lasts. Stock and the journal are
+    // each written once for the whole batch.
+    vector<AdvanceResult> advanceOrders(const vector<uint64_t>& orderIds) {
+        STATS_TIME(StatAdvanceOrders);
+        auto data = Persister::lockData(persister);
+        vector<AdvanceResult> results;
+        results.reserve(orderIds.size());
+        vector<size_t> targets(orderIds.size(), OrderStore::NoSlot);
+        vector<shared_ptr<const Recipe>> needs(orderIds.size());
+        vector<double> demand(stock.slotCount(), 0.0);
+        vector<double> reservedDemand(stock.slotCount(), 0.0);
+        bool anyReceived = false, anyReserved = false;
+
+        for (size_t i = 0; i < orderIds.size(); i++) {
+            results.push_back({ orderIds[i], false, "" });
+            size_t slot = orders.find(orderIds[i]);
+            if (slot == OrderStore::NoSlot) { results[i].message = "Order not found!"; continue; }
+            OrderStatus status = orders.status(slot);
+            if (status == Ready) { results[i].message = "Order is already Ready"; continue; }
+            if (status == Cancelled) { results[i].message = "Order was cancelled"; continue; }
+            if (std::find(targets.begin(), targets.begin() + i, slot) != targets.begin() + i) {
+                results[i].message = "Duplicate order in batch";
+                continue;
+            }
+            auto reserved = status == Received ? reservations.find(orderIds[i]) : reservations.end();
+            if (reserved != reservations.end()) {
+                Stock::addDemand(*reserved->second, reservedDemand);
+                anyReserved = true;
+            }
+            else if (status == Received) {
+                if (!dishesRef) { results[i].message = "Dish list is not loaded!"; continue; }
+                auto recipe = recipeFor(orders.dishKey(slot));
+                if (!recipe) { results[i].message = "Dish does not exist in the menu!"; continue; }
+                if (!recipe->missing.empty()) {
+                    results[i].message = "Ingredient not found in stock: " + recipe->missing;
+                    continue;
+                }
+                needs[i] = recipe;
+                Stock::addDemand(*recipe, demand);
+                anyReceived = true;
+            }
+            targets[i] = slot;
+        }
+
+        if (anyReceived && !stock.covers(demand)) {
+            // Hamısı sığmır: sıra ilə, stok çatana qədər qəbul edirik.
+            fill(demand.begin(), demand.end(), 0.0);
+            for (size_t i = 0; i < orderIds.size(); i++) {
+                if (!needs[i]) continue;
+                Stock::addDemand(*needs[i], demand);
+                if (!stock.covers(demand)) {
+                    for (const RecipeLine& line : needs[i]->lines)
+                        demand[line.slot] -= line.amount;
+                    targets[i] = OrderStore::NoSlot;
+                    results[i].message = "Not enough ingredients in stock";
+                }
+            }
+        }
+        if (anyReceived) stock.deductDemand(demand);
+        if (anyReserved) stock.commitReservedDemand(reservedDemand);
+        if (anyReceived || anyReserved) stock.saveStorage();
+
+        bool anyMoved = false;
+        for (size_t i = 0; i < orderIds.size(); i++) {
+            size_t slot = targets[i];
+            if (slot == OrderStore::NoSlot) continue;
+            OrderStatus status = orders.status(slot);
+            if (status == Received) reservations.erase(orderIds[i]);
+            orders.setStatus(slot, (OrderStatus)(status + 1));
+            journal.appendStatus(orders, slot);
+            results[i].ok = true;
+            results[i].message = statusToString(orders.status(slot));
+            anyMoved = true;
+        }
+        if (anyMoved) journalChanged();
+        return results;
+    }
+
+    vector<AdvanceResult> advanceAllInStatus(OrderStatus status) {
+        return advanceOrders(ordersInStatus(status));
+    }
+
+    static void showAdvanceResults(const vector<AdvanceResult>& results) {
+        if (results.empty()) { cout << "No orders to advance.\n"; return; }
+        size_t moved = 0;
+        for (const auto& r : results) {
+            if (r.ok) {
+                moved++;
+                cout << "Order #" << r.orderId << " -> " << r.message << "\n";
+            }
+            else cout << "Order #" << r.orderId << " failed: " << r.message << "\n";
+        }
+        cout << moved << " of " << results.size() << " orders advanced.\n";
+    }
+
+    void showMyOrderStatus(const string& userId) const {
+        string text;
+        orders.forEachOfUser(userId, [&](size_t slot) {
+            text += "Order #" + to_string(orders.id(slot)) + " | Dish: " + orders.dishName(slot)
+                + " | Status: " + statusToString(orders.status(slot)) + "\n";
+        });
+        if (text.empty())
+            text = "You have no active orders.\n";
+        writeBlock(cout, text);
+    }
+
+    // Copies one order out; false if there is no such order.
+    bool findOrder(uint64_t orderId, Order& out) const {
+        auto data = Persister::lockData(persister);
+        size_t slot = orders.find(orderId);
+        if (slot == OrderStore::NoSlot) return false;
+        out = orders.get(slot);
+        return true;
+    }
+
+    // Every order of the user, oldest first.
+    vector<Order> ordersOfUser(const string& userId) const {
+        auto data = Persister::lockData(persister);
+        vector<Order> list;
+        orders.forEachOfUser(userId, [&](size_t slot) { list.push_back(orders.get(slot)); });
+        return list;
+    }
+
+    OrderPage queryOrders(const OrderQuery& query) const {
+        return orders.query(query);
+    }
+
+    // Prints one page of a listing in a single write; returns the resume token.
+    uint64_t showOrders(const OrderQuery& query) const {
+        OrderPage page = orders.query(query);
+        string text = "\nCurrent Orders:\n";
+        for (const auto& ord : page.orders)
+            text += "Order #" + to_string(ord.id) + ", UserID: " + ord.userId + ", Dish: " + ord.dishName
+                + ", Status: " + statusToString(ord.status) + "\n";
+        if (page.orders.empty())
+            text += "(No orders found)\n";
+        writeBlock(cout, text);
+        return page.next;
+    }
+
+    size_t countInStatus(OrderStatus status) const { return orders.countInStatus(status); }
+
+    // Kitchen display: counts of every stage and the first orders waiting in
+    // each active stage, read from the status buckets.
+    void showOrderBoard(size_t perStage = 10) const {
+        auto data = Persister::lockData(persister);
+        string text = "\n=== ORDER BOARD ===\n";
+        uint32_t now = (uint32_t)time(nullptr);
+        for (int st = Received; st <= Cancelled; st++)
+            text += statusToString((OrderStatus)st) + ": " + to_string(orders.countInStatus((OrderStatus)st))
+                + (st == Cancelled ? "\n" : " | ");
+        for (int st = Received; st < Ready; st++) {
+            size_t count = orders.countInStatus((OrderStatus)st);
+            if (!count) continue;
+            text += "\n" + statusToString((OrderStatus)st) + ":\n";
+            size_t shown = 0;
+            orders.forEachInStatus((OrderStatus)st, [&](size_t slot) {
+                text += "  Order #" + to_string(orders.id(slot)) + ", UserID: " + orders.userId(slot)
+                    + ", Dish: " + orders.dishName(slot);
+                if (uint32_t placed = orders.createdAt(slot))
+                    text += ", Waiting: " + to_string(now > placed ? (now - placed) / 60 : 0) + " min";
+                text += "\n";
+                return ++shown < perStage;
+            });
+            if (count > shown) text += "  ... " + to_string(count - shown) + " more\n";
+        }
+        writeBlock(cout, text);
+    }
+
+    // -- KitchenEngine üçün (worker thread-lərdən çağırılır) --
+    vector<uint64_t> ordersInStatus(OrderStatus status) const {
+        vector<uint64_t> ids;
+        ids.reserve(orders.countInStatus(status));
+        orders.forEachInStatus(status, [&](size_t slot) {
+            ids.push_back(orders.id(slot));
+            return true;
+        });
+        return ids;
+    }
+
+    // Received -> Preparing stock step for one order, without file I/O.
+    // Returns false if the order cannot be covered by stock.
+    bool commitForPreparing(uint64_t orderId) {
+        lock_guard<mutex> lock(kitchenMutex);
+        auto data = Persister::lockData(persister);
+        auto reserved = reservations.find(orderId);
+        if (reserved != reservations.end()) {
+            stock.commitReservation(*reserved->second);
+            reservations.erase(reserved);
+            return true;
+        }
+        size_t slot = orders.find(orderId);
+        if (slot == OrderStore::NoSlot || !dishesRef) return false;
+        auto recipe = recipeFor(orders.dishKey(slot));
+        if (!recipe || !recipe->missing.empty() || stock.findShortage(*recipe) >= 0) return false;
+        stock.deduct(*recipe);
+        return true;
+    }
+
+    // Applies a batch of engine transitions: the stock file is written first
+    // (so a crash never loses a deduction), then all journal records with one flush.
+    // With a persister both go to its next round, which keeps the same order.
+    void applyTransitions(const vector<pair<uint64_t, OrderStatus>>& batch, bool stockChanged) {
+        string stockContent;
+        {
+            lock_guard<mutex> lock(kitchenMutex);
+            auto data = Persister::lockData(persister);
+            if (stockChanged && persister) stock.saveStorage();
+            else if (stockChanged) stockContent = stock.renderForDisk();
+            for (const auto& t : batch)
+                if (size_t slot = orders.find(t.first); slot != OrderStore::NoSlot) orders.setStatus(slot, t.second);
+        }
+        if (stockChanged && !persister) {
+            try { writeFileAtomically(stock.storagePath(), stockContent); }
+            catch (const string& ex) { cout << ex << endl; }
+        }
+        auto data = Persister::lockData(persister);
+        for (const auto& t : batch)
+            if (size_t slot = orders.find(t.first); slot != OrderStore::NoSlot) journal.appendStatus(orders, slot);
+        journalChanged();
+    }
+
+    // -- Orders Faylda SAXLA/oxu --
+    void saveOrders(const string& filePath = "Orders.txt") {
+        try { writeFileAtomically(filePath, OrderJournal::renderSnapshot(orders)); }
+        catch (...) {}
+    }
+    bool loadOrdersSnapshot(const string& filePath = "Orders.bin") {
+        orders.clear();
+        SnapshotView view;
+        string error = view.open(filePath, SnapshotOrders, sizeof(OrderSnapshotRecord));
+        if (!error.empty()) {
+            cout << "Cannot use " << filePath << " (" << error << "), reading text file.\n";
+            return false;
+        }
+        const OrderSnapshotRecord* rec = view.records<OrderSnapshotRecord>();
+        orders.reserve(view.count());
+        for (size_t i = 0; i < view.count(); i++) {
+            if (rec[i].status > Cancelled) continue;
+            orders.insert(Order(rec[i].id, string(view.str(rec[i].userId)),
+                string(view.str(rec[i].dishName)), (int)rec[i].status, rec[i].createdAt));
+        }
+        return true;
+    }
+
+    // Switches between Orders.bin and Orders.txt (see --convert).
+    void setBinarySnapshot(bool on) {
+        journal.checkpoint(orders);
+        journal.setSnapshot(dir + (on ? "Orders.bin" : "Orders.txt"), on);
+        journal.checkpoint(orders);
+        if (!on) {
+            error_code ec;
+            fs::remove(dir + "Orders.bin", ec);
+        }
+    }
+
+    void loadOrders(const string& filePath = "Orders.txt") {
+        orders.clear();
+        LineReader reader(filePath);
+        if (!reader.isOpen()) return;
+        string_view line;
+        Order ord(0, "", "");
+        while (reader.next(line)) {
+            if (line.empty()) continue;
+            if (Order::parse(line, ord)) orders.insert(move(ord));
+            else reportMalformedRow(filePath, reader.lineNumber(), "expected id_userId_dish_status");
+        }
+    }
+};
+
+// ==== BOUNDED QUEUE ====
+// Lock-free bounded multi-producer/multi-consumer queue (Dmitry Vyukov's design):
+// every cell carries a sequence number that tells producers and consumers
+// whose turn it is, so push and pop are a single CAS on the fast path.
+template <class T>
+class BoundedQueue {
+    struct Cell {
+        atomic<size_t> seq;
+        T value;
+    };
+    unique_ptr<Cell[]> cells;
+    size_t mask;
+    alignas(64) atomic<size_t> enqueuePos{ 0 };
+    alignas(64) atomic<size_t> dequeuePos{ 0 };
+public:
+    explicit BoundedQueue(size_t capacity) {
+        size_t size = 2;
+        while (size < capacity) size <<= 1;
+        cells.reset(new Cell[size]);
+        mask = size - 1;
+        for (size_t i = 0; i < size; i++) cells[i].seq.store(i, memory_order_relaxed);
+    }
+
+    bool tryPush(const T& value) {
+        Cell* cell;
+        size_t pos = enqueuePos.load(memory_order_relaxed);
+        for (;;) {
+            cell = &cells[pos & mask];
+            size_t seq = cell->seq.load(memory_order_acquire);
+            intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+            if (diff == 0) {
+                if (enqueuePos.compare_exchange_weak(pos, pos + 1, memory_order_relaxed)) break;
+            }
+            else if (diff < 0) return false; // dolu
+            else pos = enqueuePos.load(memory_order_relaxed);
+        }
+        cell->value = value;
+        cell->seq.store(pos + 1, memory_order_release);
+        return true;
+    }
+
+    bool tryPop(T& value) {
+        Cell* cell;
+        size_t pos = dequeuePos.load(memory_order_relaxed);
+        for (;;) {
+            cell = &cells[pos & mask];
+            size_t seq = cell->seq.load(memory_order_acquire);
+            intptr_t diff = (intptr_t)seq - (intptr_t)(pos + 1);
+            if (diff == 0) {
+                if (dequeuePos.compare_exchange_weak(pos, pos + 1, memory_order_relaxed)) break;
+            }
+            else if (diff < 0) return false; // boş
+            else pos = dequeuePos.load(memory_order_relaxed);
+        }
+        value = cell->value;
+        cell->seq.store(pos + mask + 1, memory_order_release);
+        return true;
+    }
+
+    // Spins (yielding) until there is room.
+    void push(const T& value) {
+        while (!tryPush(value)) this_thread::yield();
+    }
+
+    size_t sizeApprox() const {
+        size_t head = enqueuePos.load(memory_order_relaxed);
+        size_t tail = dequeuePos.load(memory_order_relaxed);
+        return head > tail ? head - tail : 0;
+    }
+};
+
+// ==== KITCHEN ENGINE ====
+// Runs orders through Received -> Preparing -> Cooking -> Packed -> Ready on
+// worker threads. Each of the four working stages has its own pool of workers
+// and a bounded queue in front of it. Workers never touch files: transitions
+// go to one writer thread that applies them in batches (OrderManager::applyTransitions).
+static const int kitchenStages = 4; // Received..Packed; Ready is the exit
+
+struct KitchenConfig {
+    int workers[kitchenStages] = { 1, 1, 1, 1 };
+    int serviceMs[kitchenStages] = { 0, 0, 0, 0 };
+    size_t queueCapacity = 1024;
+};
+
+struct KitchenReport {
+    size_t processed[kitchenStages] = {};
+    size_t maxDepth[kitchenStages] = {};
+    double avgDepth[kitchenStages] = {};
+    size_t completed = 0;
+    size_t failed = 0;
+    double seconds = 0;
+};
+
+class KitchenEngine {
+public:
+    // Called by a stage worker before the order moves on (simulates the work).
+    using StageHandler = function<void(uint64_t orderId, OrderStatus stage)>;
+private:
+    typedef pair<uint64_t, OrderStatus> Transition;
+
+    OrderManager& orderManager;
+    KitchenConfig config;
+    StageHandler handlers[kitchenStages];
+    unique_ptr<BoundedQueue<uint64_t>> queues[kitchenStages];
+    unique_ptr<BoundedQueue<Transition>> transitions;
+    atomic<size_t> inFlight{ 0 };
+    atomic<size_t> processed[kitchenStages];
+    atomic<size_t> failed{ 0 };
+    atomic<size_t> completed{ 0 };
+    atomic<bool> stockChanged{ false };
+    atomic<bool> workersDone{ false };
+    atomic<bool> writerDone{ false };
+
+    void workerLoop(int stage) {
+        uint64_t id;
+        while (!workersDone.load(memory_order_acquire)) {
+            if (!queues[stage]->tryPop(id)) {
+                this_thread::sleep_for(chrono::microseconds(100));
+                continue;
+            }
+            if (handlers[stage]) handlers[stage](id, (OrderStatus)stage);
+            if (stage == Received) {
+                if (!orderManager.commitForPreparing(id)) {
+                    failed++;
+                    inFlight--;
+                    continue;
+                }
+                stockChanged.store(true, memory_order_release);
+            }
+            OrderStatus next = (OrderStatus)(stage + 1);
+            transitions->push({ id, next });
+            processed[stage]++;
+            if (next == Ready) {
+                completed++;
+                inFlight--;
+            }
+            else queues[next]->push(id);
+        }
+    }
+
+    void writerLoop() {
+        vector<Transition> batch;
+        Transition t;
+        for (;;) {
+            batch.clear();
+            while (batch.size() < 4096 && transitions->tryPop(t)) batch.push_back(t);
+            if (batch.empty()) {
+                if (writerDone.load(memory_order_acquire)) {
+                    if (!transitions->tryPop(t)) return;
+                    batch.push_back(t);
+                }
+                else {
+                    this_thread::sleep_for(chrono::milliseconds(1));
+                    continue;
+                }
+            }
+            orderManager.applyTransitions(batch, stockChanged.exchange(false));
+        }
+    }
+public:
+    KitchenEngine(OrderManager& om, const KitchenConfig& config) : orderManager(om), config(config) {
+        for (int s = 0; s < kitchenStages; s++) {
+            int ms = config.serviceMs[s];
+            if (ms > 0)
+                handlers[s] = [ms](uint64_t, OrderStatus) { this_thread::sleep_for(chrono::milliseconds(ms)); };
+        }
+    }
+
+    void setHandler(OrderStatus stage, StageHandler handler) {
+        if (stage >= Received && stage < Ready) handlers[stage] = handler;
+    }
+
+    // Pushes every order that is not yet Ready through the pipeline and
+    // returns once all of them are Ready (or failed at the stock step).
+    KitchenReport run() {
+        for (int s = 0; s < kitchenStages; s++) {
+            queues[s].reset(new BoundedQueue<uint64_t>(config.queueCapacity));
+            processed[s] = 0;
+        }
+        transitions.reset(new BoundedQueue<Transition>(config.queueCapacity * 4));
+        failed = 0;
+        completed = 0;
+        workersDone = false;
+        writerDone = false;
+
+        vector<uint64_t> backlog[kitchenStages];
+        size_t total = 0;
+        for (int s = 0; s < kitchenStages; s++) {
+            backlog[s] = orderManager.ordersInStatus((OrderStatus)s);
+            total += backlog[s].size();
+        }
+        inFlight = total;
+
+        auto start = chrono::steady_clock::now();
+        thread writer(&KitchenEngine::writerLoop, this);
+        vector<thread> workers;
+        for (int s = 0; s < kitchenStages; s++)
+            for (int w = 0; w < max(1, config.workers[s]); w++)
+                workers.emplace_back(&KitchenEngine::workerLoop, this, s);
+
+        KitchenReport report;
+        size_t samples = 0;
+        double depthSum[kitchenStages] = {};
+        auto sample = [&]() {
+            samples++;
+            for (int s = 0; s < kitchenStages; s++) {
+                size_t depth = queues[s]->sizeApprox();
+                report.maxDepth[s] = max(report.maxDepth[s], depth);
+                depthSum[s] += (double)depth;
+            }
+        };
+        // Sona yaxın mərhələlərdən başlayırıq ki, növbələr dolub bir-birini bloklamasın.
+        for (int s = kitchenStages - 1; s >= 0; s--)
+            for (uint64_t id : backlog[s]) {
+                while (!queues[s]->tryPush(id)) {
+                    sample();
+                    this_thread::sleep_for(chrono::milliseconds(1));
+                }
+            }
+        while (inFlight.load() > 0) {
+            sample();
+            this_thread::sleep_for(chrono::milliseconds(5));
+        }
+        workersDone = true;
+        for (auto& w : workers) w.join();
+        writerDone = true;
+        writer.join();
+
+        report.seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        for (int s = 0; s < kitchenStages; s++) {
+            report.processed[s] = processed[s];
+            report.avgDepth[s] = samples ? depthSum[s] / samples : 0;
+        }
+        report.completed = completed;
+        report.failed = failed;
+        return report;
+    }
+
+    static void showReport(const KitchenReport& r) {
+        cout << "\n=== KITCHEN REPORT ===\n";
+        cout << "Orders ready: " << r.completed << ", failed at stock step: " << r.failed
+            << ", time: " << r.seconds << " s\n";
+        for (int s = 0; s < kitchenStages; s++) {
+            double rate = r.seconds > 0 ? r.processed[s] / r.seconds : 0;
+            cout << OrderManager::statusToString((OrderStatus)s) << ": " << r.processed[s]
+                << " done, " << rate << " orders/s, queue depth avg " << r.avgDepth[s]
+                << " max " << r.maxDepth[s] << "\n";
+        }
+    }
+};
+
+// ==== KITCHEN SHARDS ====
+// Sharded deployment: N kitchens, each with its own Stock, OrderManager,
+// Persister and data directory (<root>/<i>/), owned by one thread that
+// drains the shard's mailbox. Nothing on the order path is shared between
+// shards; KitchenShards only routes commands and answers global queries by
+// running a task on every shard. It is driven from a single thread.
+// Order IDs are global: local ID * shard count + shard index, so an ID names
+// its shard (a data root therefore belongs to one shard count).
+enum RoutePolicy { RouteUserHash, RouteLeastLoaded, RouteStock };
+
+struct ShardCommand {
+    enum Kind : uint8_t { Create, Tick, Call, Stop };
+    Kind kind = Call;
+    char userId[8] = {};
+    uint32_t dish = 0;                  // Create: menu index
+    function<void()>* task = nullptr;   // Call: runs on the shard thread
+};
+
+class KitchenShards {
+    struct Shard {
+        size_t index;
+        string dir;
+        Stock stock;
+        OrderManager orders;
+        vector<Dish> menu;
+        Persister persister;            // stores above outlive its flusher
+        BoundedQueue<ShardCommand> mailbox{ 4096 };
+        // Published by the shard thread for the router; only hints, the
+        // shard itself still checks stock when the order arrives.
+        atomic<size_t> open{ 0 };       // orders not yet Ready
+        unique_ptr<atomic<uint32_t>[]> servings;    // per menu dish
+        // Shard thread only (read them through callShards).
+        size_t created = 0;
+        size_t rejected = 0;
+        thread worker;
+
+        Shard(size_t index, const string& dir, const PersistConfig& config)
+            : index(index), dir(dir), stock(dir), orders(stock, dir), persister(config) {
+        }
+    };
+
+    vector<unique_ptr<Shard>> shards;
+    RoutePolicy policy;
+    unordered_map<string, uint32_t> menuIndex;  // dish name -> menu index
+
+    void publishServings(Shard& s, size_t dish) {
+        s.servings[dish].store(s.orders.servingsAvailable(dish), memory_order_relaxed);
+    }
+
+    void publishAll(Shard& s) {
+        for (size_t d = 0; d < s.menu.size(); d++) publishServings(s, d);
+        size_t open = 0;
+        for (int st = Received; st < Ready; st++) open += s.orders.countInStatus((OrderStatus)st);
+        s.open.store(open, memory_order_relaxed);
+    }
+
+    void workerLoop(Shard& s) {
+        ShardCommand cmd;
+        size_t idle = 0;
+        for (;;) {
+            if (!s.mailbox.tryPop(cmd)) {
+                // Bir az gözləyib yuxuya gedirik ki, boş shard CPU yeməsin.
+                if (++idle < 64) this_thread::yield();
+                else this_thread::sleep_for(chrono::microseconds(100));
+                continue;
+            }
+            idle = 0;
+            switch (cmd.kind) {
+            case ShardCommand::Stop:
+                return;
+            case ShardCommand::Call:
+                (*cmd.task)();
+                break;
+            case ShardCommand::Create:
+                try {
+                    s.orders.createOrder(cmd.userId, s.menu[cmd.dish].getName());
+                    s.created++;
+                    s.open.fetch_add(1, memory_order_relaxed);
+                }
+                catch (const string&) { s.rejected++; }
+                publishServings(s, cmd.dish);
+                break;
+            case ShardCommand::Tick:
+                // Sondan başlayırıq ki, hər sifariş bir tikdə yalnız bir mərhələ irəliləsin.
+                for (int st = Packed; st >= Received; st--) s.orders.advanceAllInStatus((OrderStatus)st);
+                publishAll(s);
+                break;
+            }
+        }
+    }
+
+    // Runs f(shard) on the threads of shards [first, last) at the same time
+    // and waits for all of them; the first string a task throws is rethrown.
+    template <class F>
+    void callShards(size_t first, size_t last, F f) {
+        mutex m;
+        condition_variable done;
+        size_t left = last - first;
+        string error;
+        vector<function<void()>> tasks;
+        tasks.reserve(left);
+        for (size_t i = first; i < last; i++) {
+            Shard* s = shards[i].get();
+            tasks.emplace_back([&, s] {
+                string failure;
+                try { f(*s); }
+                catch (const string& ex) { failure = ex; }
+                lock_guard<mutex> lock(m);
+                if (error.empty()) error = failure;
+                if (--left == 0) done.notify_one();
+            });
+            ShardCommand cmd;
+            cmd.task = &tasks.back();
+            s->mailbox.push(cmd);
+        }
+        unique_lock<mutex> lock(m);
+        done.wait(lock, [&] { return left == 0; });
+        if (!error.empty()) throw error;
+    }
+
+    template <class F>
+    void callAll(F f) { callShards(0, shards.size(), f); }
+
+    size_t load(const Shard& s) const {
+        return s.open.load(memory_order_relaxed) + s.mailbox.sizeApprox();
+    }
+
+    size_t route(string_view userId, uint32_t dish) const {
+        size_t byUser = fnv1a32(userId.data(), userId.size()) % shards.size();
+        if (policy == RouteUserHash) return byUser;
+        size_t best = policy == RouteStock ? byUser : 0;
+        uint32_t bestServings = 0;
+        for (size_t i = 0; i < shards.size(); i++) {
+            if (policy == RouteStock) {
+                // Ən çox porsiya çıxara bilən mətbəx; bərabərdirsə, az yüklü olan.
+                uint32_t servings = shards[i]->servings[dish].load(memory_order_relaxed);
+                if (servings == 0 || servings < bestServings) continue;
+                if (servings == bestServings && load(*shards[i]) >= load(*shards[best])) continue;
+                bestServings = servings;
+                best = i;
+            }
+            else if (load(*shards[i]) < load(*shards[best])) best = i;
+        }
+        return best;
+    }
+
+    ShardCommand createCommand(const string& userId, const string& dishName, size_t& shard) const {
+        auto it = menuIndex.find(dishName);
+        if (it == menuIndex.end()) throw string("Dish does not exist in the menu!");
+        ShardCommand cmd;
+        if (userId.empty() || userId.size() >= sizeof(cmd.userId)) throw string("Invalid user ID!");
+        cmd.kind = ShardCommand::Create;
+        memcpy(cmd.userId, userId.data(), userId.size());
+        cmd.dish = it->second;
+        shard = route(userId, cmd.dish);
+        return cmd;
+    }
+
+    uint64_t globalId(uint64_t localId, size_t shard) const { return localId * shards.size() + shard; }
+public:
+    // Opens (or creates) <root>/0 .. <root>/<count-1>. A new shard starts with
+    // an equal share of `seed`'s stock; every shard gets a copy of the menu.
+    KitchenShards(size_t count, RoutePolicy policy, const Stock& seed, const vector<Dish>& menu,
+        const string& root = "kitchens/", const PersistConfig& config = {}) : policy(policy) {
+        if (count == 0) throw string("At least one kitchen is needed!");
+        for (size_t i = 0; i < count; i++) {
+            string dir = root + to_string(i) + "/";
+            bool fresh = !fs::exists(dir);
+            error_code ec;
+            fs::create_directories(dir, ec);
+            if (ec) throw string("Cannot create " + dir);
+            shards.push_back(make_unique<Shard>(i, dir, config));
+            Shard& s = *shards.back();
+            // Stok əvvəl qeydə alınır: raund stok faylını jurnaldan əvvəl yazır.
+            s.stock.setPersister(&s.persister);
+            s.orders.setPersister(&s.persister);
+            if (fresh)
+                seed.forEachIngredient([&](const string& name, double amount, double) {
+                    s.stock.restock(name, amount / count);
+                });
+        }
+        for (auto& s : shards) {
+            s->menu = menu;
+            s->orders.bindDishList(&s->menu);
+            s->servings.reset(new atomic<uint32_t>[menu.size()]);
+            publishAll(*s);
+        }
+        for (uint32_t i = 0; i < menu.size(); i++) menuIndex[menu[i].getName()] = i;
+        for (auto& s : shards) {
+            Shard* shard = s.get();
+            shard->worker = thread([this, shard] { workerLoop(*shard); });
+        }
+    }
+    KitchenShards(const KitchenShards&) = delete;
+    KitchenShards& operator=(const KitchenShards&) = delete;
+
+    // Stops the shard threads, then writes each shard's data and checkpoints its orders.
+    ~KitchenShards() {
+        for (auto& s : shards) {
+            ShardCommand stop;
+            stop.kind = ShardCommand::Stop;
+            s->mailbox.push(stop);
+        }
+        for (auto& s : shards) {
+            s->worker.join();
+            try {
+                s->persister.shutdown();
+                s->orders.checkpoint();
+            }
+            catch (const string& ex) { cout << ex << endl; }
+        }
+    }
+
+    static bool parsePolicy(string_view name, RoutePolicy& policy) {
+        if (name == "user") policy = RouteUserHash;
+        else if (name == "least") policy = RouteLeastLoaded;
+        else if (name == "stock") policy = RouteStock;
+        else return false;
+        return true;
+    }
+
+    size_t size() const noexcept { return shards.size(); }
+
+    // Routes and queues the order without waiting; a kitchen that cannot
+    // cover it counts it as rejected (see showSummary).
+    void submitOrder(const string& userId, const string& dishName) {
+        size_t shard;
+        ShardCommand cmd = createCommand(userId, dishName, shard);
+        shards[shard]->mailbox.push(cmd);
+    }
+
+    // Like OrderManager::createOrder: waits for the kitchen and returns the global ID.
+    uint64_t createOrder(const string& userId, const string& dishName) {
+        size_t shard;
+        ShardCommand cmd = createCommand(userId, dishName, shard);
+        uint64_t id = 0;
+        callShards(shard, shard + 1, [&](Shard& s) {
+            id = globalId(s.orders.createOrder(userId, dishName), shard);
+            s.created++;
+            s.open.fetch_add(1, memory_order_relaxed);
+            publishServings(s, cmd.dish);
+        });
+        return id;
+    }
+
+    OrderManager::AdvanceResult advanceOrder(uint64_t orderId) {
+        size_t shard = orderId % shards.size();
+        OrderManager::AdvanceResult result;
+        callShards(shard, shard + 1, [&](Shard& s) {
+            result = s.orders.advanceOrders({ orderId / shards.size() })[0];
+            publishAll(s);
+        });
+        result.orderId = orderId;
+        return result;
+    }
+
+    // Every kitchen moves each of its open orders one stage forward (queued, no wait).
+    void tick() {
+        for (auto& s : shards) {
+            ShardCommand cmd;
+            cmd.kind = ShardCommand::Tick;
+            s->mailbox.push(cmd);
+        }
+    }
+
+    // Splits a delivery evenly between the kitchens.
+    void restock(const string& name, double amount) {
+        callAll([&](Shard& s) {
+            s.stock.restock(name, amount / shards.size());
+            publishAll(s);
+        });
+    }
+
+    void setMenu(const vector<Dish>& menu) {
+        callAll([&](Shard& s) {
+            s.menu = menu;
+            s.orders.compileMenu();
+            s.servings.reset(new atomic<uint32_t>[menu.size()]);
+            publishAll(s);
+        });
+        menuIndex.clear();
+        for (uint32_t i = 0; i < menu.size(); i++) menuIndex[menu[i].getName()] = i;
+    }
+
+    // Returns once every queued command has run and its changes are on disk.
+    void sync() {
+        callAll([](Shard&) {});
+        for (auto& s : shards) s->persister.sync();
+    }
+
+    // -- Global queries (run on every kitchen at once) --
+    // The user's orders from all kitchens with global IDs, oldest first.
+    vector<Order> ordersOfUser(const string& userId) {
+        vector<vector<Order>> parts(shards.size());
+        callAll([&](Shard& s) { parts[s.index] = s.orders.ordersOfUser(userId); });
+        vector<Order> all;
+        for (size_t i = 0; i < parts.size(); i++)
+            for (Order& ord : parts[i]) {
+                ord.id = globalId(ord.id, i);
+                all.push_back(move(ord));
+            }
+        stable_sort(all.begin(), all.end(), [](const Order& a, const Order& b) { return a.createdAt < b.createdAt; });
+        return all;
+    }
+
+    // Stock summed over the kitchens: (name, amount, reserved) in first-seen order.
+    vector<tuple<string, double, double>> totalStock() {
+        vector<vector<tuple<string, double, double>>> parts(shards.size());
+        callAll([&](Shard& s) {
+            s.stock.forEachIngredient([&](const string& name, double amount, double reserved) {
+                parts[s.index].emplace_back(name, amount, reserved);
+            });
+        });
+        vector<tuple<string, double, double>> total;
+        unordered_map<string, size_t, CaseInsensitiveHash, CaseInsensitiveEqual> row;
+        for (auto& part : parts)
+            for (auto& line : part) {
+                auto it = row.emplace(get<0>(line), total.size());
+                if (it.second) total.push_back(move(line));
+                else {
+                    get<1>(total[it.first->second]) += get<1>(line);
+                    get<2>(total[it.first->second]) += get<2>(line);
+                }
+            }
+        return total;
+    }
+
+    size_t countInStatus(OrderStatus status) {
+        vector<size_t> counts(shards.size());
+        callAll([&](Shard& s) { counts[s.index] = s.orders.countInStatus(status); });
+        size_t sum = 0;
+        for (size_t c : counts) sum += c;
+        return sum;
+    }
+
+    // One line per kitchen (orders taken, rejected, per stage) and the totals.
+    void showSummary() {
+        static const int columns = Cancelled + 3;
+        vector<array<size_t, columns>> rows(shards.size() + 1);
+        callAll([&](Shard& s) {
+            auto& row = rows[s.index];
+            row[0] = s.created;
+            row[1] = s.rejected;
+            for (int st = Received; st <= Cancelled; st++) row[st + 2] = s.orders.countInStatus((OrderStatus)st);
+        });
+        string text = "\n=== KITCHENS ===\nkitchen  created rejected";
+        for (int st = Received; st <= Cancelled; st++) {
+            char head[16];
+            snprintf(head, sizeof(head), " %9.9s", OrderManager::statusToString((OrderStatus)st).c_str());
+            text += head;
+        }
+        text += "\n";
+        for (size_t i = 0; i <= shards.size(); i++) {
+            char cell[32];
+            if (i < shards.size()) {
+                for (int c = 0; c < columns; c++) rows.back()[c] += rows[i][c];
+                snprintf(cell, sizeof(cell), "%-7zu", i);
+            }
+            else snprintf(cell, sizeof(cell), "%-7s", "total");
+            text += cell;
+            for (int c = 0; c < columns; c++) {
+                snprintf(cell, sizeof(cell), c < 2 ? " %8zu" : " %9zu", rows[i][c]);
+                text += cell;
+            }
+            text += "\n";
+        }
+        writeBlock(cout, text);
+    }
+};
+
+// ==== ADMIN CLASS ====
+class Admin {
+    Stock& stock;
+    vector<Dish> dishes;
+    OrderManager& orderManager;
+    bool binarySnapshot = false; // Dishes.bin istifadə olunur
+    Persister* persister = nullptr;
+    size_t persistSlot = 0;
+public:
+    Admin(OrderManager& om, Stock& stock) : stock(stock), orderManager(om) {
+        binarySnapshot = fs::exists("Dishes.bin");
+        if (!binarySnapshot || !loadSnapshot()) loadAllData();
+        orderManager.bindDishList(&dishes);
+    }
+
+    const vector<Dish>& getDishes() const noexcept { return dishes; }
+
+    void AdminPanel() {
+        int choice;
+        do {
+            cout << "\n=== ADMIN PANEL ===\n";
+            cout << "1. Add new dish\n";
+            cout << "2. Edit dish\n";
+            cout << "3. Delete dish\n";
+            cout << "4. Show all dishes\n";
+            cout << "5. Add ingredient to stock\n";
+            cout << "6. Show stock\n";
+            cout << "7. Move order status forward\n";
+            cout << "8. Browse orders\n";
+            cout << "9. Advance all orders in a status\n";
+            cout << "10. Advance selected orders\n";
+            cout << "11. Run kitchen engine\n";
+            cout << "12. Order board\n";
+            cout << "13. Performance stats\n";
+            cout << "14. Archive finished orders\n";
+            cout << "15. Order history (archive)\n";
+            cout << "0. Exit\n";
+            cout << "Choice: ";
+            cin >> choice;
+
+            if (choice == 7) {
+                // Yalnız ən köhnə aktiv sifarişlərin bir səhifəsi; axtarış üçün 8.
+                OrderQuery active;
+                active.statusMask = OrderQuery::statusBit(Received) | OrderQuery::statusBit(Preparing)
+                    | OrderQuery::statusBit(Cooking) | OrderQuery::statusBit(Packed);
+                if (orderManager.showOrders(active))
+                    cout << "(Oldest " << active.pageSize << " active orders shown; use 8 to browse.)\n";
+                uint64_t orderId;
+                cout << "Enter Order ID: ";
+                if (!(cin >> orderId)) {
+                    cin.clear();
+                    cin.ignore(numeric_limits<streamsize>::max(), '\n');
+                    cout << "Invalid Order ID!\n";
+                    continue;
+                }
+                orderManager.moveOrderForward(orderId);
+                continue;
+            }
+            if (choice == 8) {
+                browseOrders();
+                continue;
+            }
+            if (choice == 9) {
+                int st;
+                cout << "Status (0 Received, 1 Preparing, 2 Cooking, 3 Packed): ";
+                cin >> st;
+                if (!cin || st < Received || st >= Ready) {
+                    cin.clear();
+                    cin.ignore(numeric_limits<streamsize>::max(), '\n');
+                    cout << "Invalid status!\n";
+                    continue;
+                }
+                OrderManager::showAdvanceResults(orderManager.advanceAllInStatus((OrderStatus)st));
+                continue;
+            }
+            if (choice == 10) {
+                cin.ignore(numeric_limits<streamsize>::max(), '\n');
+                string line;
+                cout << "Order IDs (space separated): ";
+                getline(cin, line);
+                stringstream ss(line);
+                vector<uint64_t> ids;
+                uint64_t id;
+                while (ss >> id) ids.push_back(id);
+                OrderManager::showAdvanceResults(orderManager.advanceOrders(ids));
+                continue;
+            }
+            if (choice == 11) {
+                runKitchen();
+                continue;
+            }
+            if (choice == 12) {
+                orderManager.showOrderBoard();
+                continue;
+            }
+            if (choice == 13) {
+                writeBlock(cout, "\n=== PERFORMANCE STATS ===\n" + Stats::report());
+                continue;
+            }
+            if (choice == 14) {
+                try {
+                    size_t moved = orderManager.archiveFinished();
+                    OrderArchive::Summary sum = orderManager.archiveSummary();
+                    cout << moved << " finished orders archived. Live orders: " << orderManager.liveOrderCount()
+                        << ", archived: " << sum.orders << " in " << sum.segments << " segments ("
+                        << sum.bytes << " bytes).\n";
+                }
+                catch (const string& ex) { cout << ex << endl; }
+                continue;
+            }
+            if (choice == 15) {
+                showOrderHistory();
+                continue;
+            }
+            switch (choice) {
+            case 1: addDish(); break;
+            case 2: updateDish(); break;
+            case 3: deleteDish(); break;
+            case 4: showAllDishes(); break;
+            case 5: addIngredientToStock(); break;
+            case 6: showStock(); break;
+            case 0: cout << "Exiting admin panel...\n"; break;
+            default: cout << "Invalid choice!\n"; break;
+            }
+        } while (choice != 0);
+    }
+
+    // "YYYY-MM-DD" -> Unix time of that day's local midnight, `days` days later.
+    static bool parseDay(const string& text, uint32_t& out, int days = 0) {
+        int year, month, day;
+        char extra;
+        if (sscanf(text.c_str(), "%d-%d-%d%c", &year, &month, &day, &extra) != 3
+            || month < 1 || month > 12 || day < 1 || day > 31) return false;
+        tm t{};
+        t.tm_year = year - 1900;
+        t.tm_mon = month - 1;
+        t.tm_mday = day + days;
+        t.tm_isdst = -1;
+        time_t at = mktime(&t);
+        if (at < 0) return false;
+        out = (uint32_t)min<time_t>(at, UINT32_MAX);
+        return true;
+    }
+
+    // Archived orders of a user and/or a date range, newest first.
+    void showOrderHistory() {
+        ArchiveQuery query;
+        string from, to;
+        cin.ignore(numeric_limits<streamsize>::max(), '\n');
+        cout << "User ID (empty for any): ";
+        getline(cin, query.userId);
+        cout << "From date YYYY-MM-DD (empty for any): ";
+        getline(cin, from);
+        cout << "To date YYYY-MM-DD (empty for any): ";
+        getline(cin, to);
+        if ((!from.empty() && !parseDay(from, query.from)) || (!to.empty() && !parseDay(to, query.to, 1))) {
+            cout << "Invalid date!\n";
+            return;
+        }
+        if (!to.empty() && query.to > 0) query.to--;
+        vector<Order> found = orderManager.orderHistory(query);
+        string text = "\nArchived Orders:\n";
+        for (const Order& ord : found) {
+            char placed[32] = "unknown";
+            tm local{};
+            if (ord.createdAt && toLocalTime(ord.createdAt, local))
+                strftime(placed, sizeof(placed), "%Y-%m-%d %H:%M", &local);
+            text += "Order #" + to_string(ord.id) + ", UserID: " + ord.userId + ", Dish: " + ord.dishName
+                + ", Status: " + OrderManager::statusToString(ord.status) + ", Placed: " + placed + "\n";
+        }
+        if (found.empty()) text += "(No archived orders found)\n";
+        else if (found.size() == query.limit) text += "(Newest " + to_string(query.limit) + " shown.)\n";
+        writeBlock(cout, text);
+    }
+
+    // Filtered order listing, one page at a time.
+    void browseOrders() {
+        OrderQuery query;
+        int st;
+        cout << "Status (-1 any, 0 Received, 1 Preparing, 2 Cooking, 3 Packed, 4 Ready, 5 Cancelled): ";
+        cin >> st;
+        if (!cin || st < -1 || st > Cancelled) {
+            cin.clear();
+            cin.ignore(numeric_limits<streamsize>::max(), '\n');
+            cout << "Invalid status!\n";
+            return;
+        }
+        if (st >= 0) query.statusMask = OrderQuery::statusBit((OrderStatus)st);
+        cin.ignore(numeric_limits<streamsize>::max(), '\n');
+        cout << "User ID (empty for any): ";
+        getline(cin, query.userId);
+        cout << "Dish name (empty for any): ";
+        getline(cin, query.dishName);
+        cout << "Page size: ";
+        if (!(cin >> query.pageSize) || query.pageSize == 0 || query.pageSize > OrderQuery::MaxPageSize) {
+            cin.clear();
+            cin.ignore(numeric_limits<streamsize>::max(), '\n');
+            query.pageSize = 20;
+        }
+        for (;;) {
+            query.cursor = orderManager.showOrders(query);
+            if (!query.cursor) break;
+            string answer;
+            cout << "Next page? (y/n): ";
+            cin >> answer;
+            if (answer != "y" && answer != "Y") break;
+        }
+    }
+
+    void runKitchen() {
+        KitchenConfig config;
+        cout << "Workers for Received, Preparing, Cooking, Packed (4 numbers): ";
+        for (int& w : config.workers) cin >> w;
+        cout << "Service time per stage in ms (4 numbers): ";
+        for (int& ms : config.serviceMs) cin >> ms;
+        if (!cin) {
+            cin.clear();
+            cin.ignore(numeric_limits<streamsize>::max(), '\n');
+            cout << "Invalid input!\n";
+            return;
+        }
+        KitchenEngine engine(orderManager, config);
+        KitchenEngine::showReport(engine.run());
+    }
+
+    void addDish() {
+        try {
+            string name, description;
+            double price;
+            int ingCount;
+
+            cin.ignore(numeric_limits<streamsize>::max(), '\n');
+            cout << "Enter dish name: ";
+            getline(cin, name);
+            cout << "Enter dish description: ";
+            getline(cin, description);
+            cout << "Enter dish price: ";
+            cin >> price;
+            cin.ignore(numeric_limits<streamsize>::max(), '\n');
+
+            Dish d(name, description, price);
+
+            cout << "How many ingredients?: ";
+            cin >> ingCount;
+            cin.ignore(numeric_limits<streamsize>::max(), '\n');
+
+            for (int i = 0; i < ingCount; i++) {
+                string ingName; double ingAmount;
+                cout << "Ingredient " << i + 1 << " name: ";
+                getline(cin, ingName);
+                cout << "Amount: ";
+                cin >> ingAmount;
+                cin.ignore(numeric_limits<streamsize>::max(), '\n');
+                d.addIngredient(Ingredient(move(ingName), ingAmount));
+            }
+
+            addDish(move(d));
+            cout << "Dish successfully added!\n";
+        }
+        catch (string ex) { cout << ex << endl; }
+    }
+
+    void addDish(Dish d) {
+        auto data = Persister::lockData(persister);
+        dishes.push_back(move(d));
+        orderManager.compileMenu();
+        saveAllData();
+    }
+
+    Stock& getStock() noexcept { return stock; }
+
+    void updateDish() {
+        try {
+            if (dishes.empty()) { cout << "No dishes available.\n"; return; }
+            cin.ignore(numeric_limits<streamsize>::max(), '\n');
+            string name;
+            cout << "Enter dish name to edit: ";
+            getline(cin, name);
+
+            for (auto& d : dishes) {
+                if (d.getName() == name) {
+                    string newDesc; double newPrice;
+                    cout << "New description: ";
+                    getline(cin, newDesc);
+                    cout << "New price: ";
+                    cin >> newPrice;
+                    cin.ignore(numeric_limits<streamsize>::max(), '\n');
+                    auto data = Persister::lockData(persister);
+                    d.setDescription(move(newDesc));
+                    d.setPrice(newPrice);
+                    orderManager.compileMenu();
+                    saveAllData();
+                    cout << "Dish updated!\n";
+                    return;
+                }
+            }
+            cout << "Dish not found!\n";
+        }
+        catch (string ex) { cout << ex << endl; }
+    }
+
+    void deleteDish() {
+        if (dishes.empty()) { cout << "No dishes to delete.\n"; return; }
+        cin.ignore(numeric_limits<streamsize>::max(), '\n');
+        string name;
+        cout << "Enter dish name to delete: ";
+        getline(cin, name);
+
+        for (size_t i = 0; i < dishes.size(); i++) {
+            if (dishes[i].getName() == name) {
+                auto data = Persister::lockData(persister);
+                dishes.erase(dishes.begin() + i);
+                orderManager.compileMenu();
+                saveAllData();
+                cout << "Dish deleted!\n";
+                return;
+            }
+        }
+        cout << "Dish not found!\n";
+    }
+
+    void showAllDishes() {
+        if (dishes.empty()) { cout << "Menu is empty.\n"; return; }
+        writeBlock(cout, orderManager.menuText(OrderManager::MenuAdmin));
+    }
+
+    void addIngredientToStock() {
+        try {
+            string name; double amount;
+            cout << "Enter ingredient name: ";
+            cin >> name;
+            cout << "Enter amount: ";
+            cin >> amount;
+            stock.addIngredient(Ingredient(move(name), amount));
+        }
+        catch (string ex) { cout << ex << endl; }
+    }
+
+    void showStock() {
+        try { stock.showStock(); }
+        catch (string ex) { cout << ex << endl; }
+    }
+
+    const char* dishesPath() const noexcept {
+        return binarySnapshot ? "Dishes.bin" : "Dishes.txt";
+    }
+
+    string renderForDisk() const {
+        return binarySnapshot ? renderSnapshot() : renderText();
+    }
+
+    void saveAllData() {
+        if (persister) persister->markDirty(persistSlot);
+        else writeFileAtomically(dishesPath(), renderForDisk());
+    }
+
+    void setPersister(Persister* p) {
+        persister = p;
+        persistSlot = p->addStore([this](vector<FileWrite>& writes) {
+            writes.emplace_back(dishesPath(), renderForDisk());
+        });
+    }
+
+    // Switches between Dishes.bin and Dishes.txt (see --convert).
+    void setBinarySnapshot(bool on) {
+        binarySnapshot = on;
+        saveAllData();
+        if (!on) {
+            error_code ec;
+            fs::remove("Dishes.bin", ec);
+        }
+    }
+
+    string renderSnapshot() const {
+        SnapshotWriter writer;
+        for (const auto& d : dishes) {
+            DishSnapshotRecord rec{};
+            rec.name = writer.addString(d.getName());
+            rec.description = writer.addString(d.getDescription());
+            rec.price = d.getPrice();
+            rec.firstIngredient = (uint32_t)writer.auxSize();
+            rec.ingredientCount = (uint32_t)d.getIngredients().size();
+            for (const auto& ing : d.getIngredients()) {
+                IngredientSnapshotRecord aux{};
+                aux.name = writer.addString(ing.getName());
+                aux.amount = ing.getAmount();
+                writer.addAux(aux);
+            }
+            writer.addRecord(rec);
+        }
+        return writer.finish(SnapshotDishes, sizeof(DishSnapshotRecord), sizeof(IngredientSnapshotRecord));
+    }
+
+    bool loadSnapshot(const string& filePath = "Dishes.bin") {
+        dishes.clear();
+        SnapshotView view;
+        string error = view.open(filePath, SnapshotDishes, sizeof(DishSnapshotRecord), sizeof(IngredientSnapshotRecord));
+        if (!error.empty()) {
+            cout << "Cannot use " << filePath << " (" << error << "), reading text file.\n";
+            return false;
+        }
+        const DishSnapshotRecord* rec = view.records<DishSnapshotRecord>();
+        const IngredientSnapshotRecord* ing = view.auxRecords<IngredientSnapshotRecord>();
+        dishes.reserve(view.count());
+        for (size_t i = 0; i < view.count(); i++) {
+            if ((uint64_t)rec[i].firstIngredient + rec[i].ingredientCount > view.auxCount()) continue;
+            try {
+                Dish d(string(view.str(rec[i].name)), string(view.str(rec[i].description)), rec[i].price);
+                for (uint32_t k = 0; k < rec[i].ingredientCount; k++) {
+                    const IngredientSnapshotRecord& line = ing[rec[i].firstIngredient + k];
+                    d.addIngredient(Ingredient(string(view.str(line.name)), line.amount));
+                }
+                dishes.push_back(move(d));
+            }
+            catch (const string&) {}
+        }
+        return true;
+    }
+
+    string renderText() const {
+        stringstream fs;
+        for (auto& d : dishes) {
+            fs << d.getName() << "_" << d.getDescription() << "_" << d.getPrice();
+            for (auto& ing : d.getIngredients())
+                fs << "_" << ing.getName() << ":" << ing.getAmount();
+            fs << "\n";
+        }
+        return fs.str();
+    }
+
+    void loadAllData(string filePath = "Dishes.txt") {
+        dishes.clear();
+        LineReader reader(filePath);
+        if (!reader.isOpen()) {
+            ofstream create(filePath);
+            create.close();
+            return;
+        }
+        string_view row;
+        string error;
+        while (reader.next(row)) {
+            if (row.empty()) continue;
+            Dish d;
+            if (parseDishRow(row, d, error)) dishes.push_back(move(d));
+            else reportMalformedRow(filePath, reader.lineNumber(), error);
+        }
+    }
+
+    // Parses name_description_price_ing:amount_... (Dishes.txt row format).
+    static bool parseDishRow(string_view row, Dish& out, string& error) {
+        FieldSplitter split(row);
+        string_view name, description, priceStr, ingPair;
+        double price = 0;
+        if (!split.next(name) || !split.next(description) || !split.next(priceStr)
+            || name.empty() || description.empty() || !parseNumber(priceStr, price)) {
+            error = "expected name_description_price";
+            return false;
+        }
+        try {
+            Dish d(string(name), string(description), price);
+            while (split.next(ingPair)) {
+                size_t pos = ingPair.find(':');
+                double ingAmount = 0;
+                if (pos == string_view::npos || !parseNumber(ingPair.substr(pos + 1), ingAmount)) {
+                    error = "bad ingredient '" + string(ingPair) + "'";
+                    return false;
+                }
+                d.addIngredient(Ingredient(string(ingPair.substr(0, pos)), ingAmount));
+            }
+            out = move(d);
+            return true;
+        }
+        catch (const string& ex) {
+            error = ex;
+            return false;
+        }
+    }
+};
+
+// ==== FIELD VALIDATORS ====
+// Hand-written matchers for the User field formats. They accept exactly the
+// languages of the original patterns (kept in verifyValidators as the oracle):
+//   phone  ^\+994(50|51|55|70|77|10|99)[0-9]{7}$
+//   email  ^[A-Za-z0-9._%+-]+@(gmail|mail|outlook|yahoo)\.(com|ru|az)$
+//   id     ^[A-Z0-9]{7}$
+enum CharClassBits : uint8_t {
+    DigitChar = 1,
+    IdChar = 2,         // A-Z 0-9
+    EmailLocalChar = 4  // A-Z a-z 0-9 . _ % + -
+};
+
+struct CharClassTable {
+    uint8_t bits[256];
+    constexpr CharClassTable() : bits{} {
+        for (int c = '0'; c <= '9'; c++) bits[c] = DigitChar | IdChar | EmailLocalChar;
+        for (int c = 'A'; c <= 'Z'; c++) bits[c] = IdChar | EmailLocalChar;
+        for (int c = 'a'; c <= 'z'; c++) bits[c] = EmailLocalChar;
+        bits[(int)'.'] = bits[(int)'_'] = bits[(int)'%'] = bits[(int)'+'] = bits[(int)'-'] = EmailLocalChar;
+    }
+};
+
+static constexpr CharClassTable charClasses{};
+
+// Branch-free over the characters: every char is tested, results are ANDed.
+static inline bool allCharsIn(string_view s, uint8_t cls) noexcept {
+    uint8_t acc = cls;
+    for (unsigned char c : s) acc &= charClasses.bits[c];
+    return acc == cls;
+}
+
+static bool matchPhoneNumber(string_view s) noexcept {
+    if (s.size() != 13 || s[0] != '+' || s[1] != '9' || s[2] != '9' || s[3] != '4') return false;
+    if (!allCharsIn(s.substr(4), DigitChar)) return false;
+    switch ((s[4] - '0') * 10 + (s[5] - '0')) {
+    case 50: case 51: case 55: case 70: case 77: case 10: case 99: return true;
+    default: return false;
+    }
+}
+
+static bool matchEmail(string_view s) noexcept {
+    size_t at = s.find('@');
+    if (at == string_view::npos || at == 0 || !allCharsIn(s.substr(0, at), EmailLocalChar)) return false;
+    string_view host = s.substr(at + 1);
+    size_t dot = host.find('.');
+    if (dot == string_view::npos) return false;
+    string_view domain = host.substr(0, dot), tld = host.substr(dot + 1);
+    bool domainOk = domain == "gmail" || domain == "mail" || domain == "outlook" || domain == "yahoo";
+    bool tldOk = tld == "com" || tld == "ru" || tld == "az";
+    return domainOk && tldOk;
+}
+
+static bool matchUserId(string_view s) noexcept {
+    return s.size() == 7 && allCharsIn(s, IdChar);
+}
+
+// Bulk validation of one column (e.g. all phone numbers of an import).
+// ok[i] is set to 1/0; returns the number of valid values.
+enum ValidatedField {
+    PhoneNumberField,
+    EmailField,
+    UserIdField
+};
+
+static size_t validateColumn(ValidatedField field, const string* values, size_t count, uint8_t* ok) {
+    size_t valid = 0;
+    switch (field) {
+    case PhoneNumberField:
+        for (size_t i = 0; i < count; i++) valid += ok[i] = matchPhoneNumber(values[i]);
+        break;
+    case EmailField:
+        for (size_t i = 0; i < count; i++) valid += ok[i] = matchEmail(values[i]);
+        break;
+    case UserIdField:
+        // Sabit uzunluq: 7 simvolluq dövr açılır və vektorlaşdırıla bilir.
+        for (size_t i = 0; i < count; i++) {
+            const string& v = values[i];
+            uint8_t acc = v.size() == 7 ? IdChar : 0;
+            for (size_t k = 0; k < 7 && k < v.size(); k++) acc &= charClasses.bits[(unsigned char)v[k]];
+            valid += ok[i] = acc == IdChar;
+        }
+        break;
+    }
+    return valid;
+}
+
+static size_t validateColumn(ValidatedField field, const vector<string>& values, vector<uint8_t>& ok) {
+    ok.resize(values.size());
+    return validateColumn(field, values.data(), values.size(), ok.data());
+}
+
+#ifndef FINALPROJECT_BENCH
+// Equivalence check of the matchers against the original std::regex patterns
+// on hand-picked edge cases plus random mutations of valid values.
+// Run with --verify-validators [count]; returns the number of mismatches.
+static size_t verifyValidators(size_t randomCases = 200000) {
+    const regex phonePattern("^\\+994(50|51|55|70|77|10|99)[0-9]{7}$");
+    const regex emailPattern("^[A-Za-z0-9._%+-]+@(gmail|mail|outlook|yahoo)\\.(com|ru|az)$");
+    const regex idPattern("^[A-Z0-9]{7}$");
+    vector<string> phones = { "+994501234567", "+994101234567", "+994991234567", "+994521234567",
+        "994501234567", "+99450123456", "+9945012345678", "+994501234a67", "+994 501234567", "",
+        "+994771234567\n", "+995501234567", "+994701234567" };
+    vector<string> emails = { "a@gmail.com", "a.b_c%d+e-f@yahoo.az", "@gmail.com", "a@gmail.co",
+        "a@gmail.com.", "a@@gmail.com", "a@b@gmail.com", "a@Gmail.com", "a@mail.ru", "a@outlook.az",
+        "a b@gmail.com", "a@gmailcom", "a@gmail..com", "\xc3\xa4@mail.ru", "a@hotmail.com", "" };
+    vector<string> ids = { "AB12345", "ab12345", "AB1234", "AB123456", "AB 1234", "0000000", "ZZZZZZZ", "" };
+
+    mt19937 rng(12345);
+    const string alphabet = "+0123456789@.abgmilotuyhcorzAZ_%- \x80";
+    auto mutate = [&](string v) {
+        int edits = 1 + (int)(rng() % 3);
+        for (int e = 0; e < edits; e++) {
+            size_t pos = v.empty() ? 0 : rng() % v.size();
+            char c = alphabet[rng() % alphabet.size()];
+            switch (rng() % 3) {
+            case 0: if (!v.empty()) v[pos] = c; break;
+            case 1: v.insert(v.begin() + pos, c); break;
+            default: if (!v.empty()) v.erase(pos, 1); break;
+            }
+        }
+        return v;
+    };
+    size_t baseP = phones.size(), baseE = emails.size(), baseI = ids.size();
+    for (size_t i = 0; i < randomCases; i++) {
+        phones.push_back(mutate(phones[rng() % baseP]));
+        emails.push_back(mutate(emails[rng() % baseE]));
+        ids.push_back(mutate(ids[rng() % baseI]));
+    }
+
+    size_t mismatches = 0;
+    auto check = [&](const char* what, const vector<string>& values, const regex& pattern, bool (*match)(string_view)) {
+        for (const auto& v : values) {
+            if (regex_match(v, pattern) != match(v)) {
+                if (mismatches < 20) cout << "Mismatch (" << what << "): '" << v << "'\n";
+                mismatches++;
+            }
+        }
+    };
+    check("phone", phones, phonePattern, matchPhoneNumber);
+    check("email", emails, emailPattern, matchEmail);
+    check("id", ids, idPattern, matchUserId);
+
+    // Bulk API must agree with the single-value matchers.
+    vector<uint8_t> ok;
+    validateColumn(PhoneNumberField, phones, ok);
+    for (size_t i = 0; i < phones.size(); i++) mismatches += ok[i] != matchPhoneNumber(phones[i]);
+    validateColumn(EmailField, emails, ok);
+    for (size_t i = 0; i < emails.size(); i++) mismatches += ok[i] != matchEmail(emails[i]);
+    validateColumn(UserIdField, ids, ok);
+    for (size_t i = 0; i < ids.size(); i++) mismatches += ok[i] != matchUserId(ids[i]);
+
+    cout << "Checked " << phones.size() + emails.size() + ids.size() << " values, "
+        << mismatches << " mismatches.\n";
+    return mismatches;
+}
+#endif
+
+// ==== USER CLASS ====
+// A validated user that is not (yet) in a store: sign-up input and parsed rows.
+// ID, phone, gender and birthdate are fixed-width fields; stored users live in
+// UserDirectory in the same fixed layout (see UserRef).
+class User {
+public:
+    static constexpr size_t IdLength = 7;       // matchUserId
+    static constexpr size_t NumberLength = 13;  // +994XXXXXXXXX
+private:
+    char id[IdLength] = {};
+    char number[NumberLength] = {};
+    uint8_t gender = Male;
+    uint8_t birthDay = 1, birthMonth = 1;
+    uint16_t birthYear = 1900;
+    string username;
+    string password;
+    string email;
+    string name;
+    string surname;
+    string card;
+public:
+    User() {}
+
+    // Builds a user from a binary snapshot row. The row was validated when it
+    // was written, so the validators are not run again.
+    static User fromSnapshot(const SnapshotView& view, const UserSnapshotRecord& rec) {
+        User u;
+        view.str(rec.id).copy(u.id, IdLength);
+        view.str(rec.number).copy(u.number, NumberLength);
+        u.username = view.str(rec.username);
+        u.password = view.str(rec.password);
+        u.email = view.str(rec.email);
+        u.name = view.str(rec.name);
+        u.surname = view.str(rec.surname);
+        u.card = view.str(rec.card);
+        u.gender = rec.gender ? Female : Male;
+        u.birthDay = rec.day;
+        u.birthMonth = rec.month;
+        u.birthYear = rec.year;
+        return u;
+    }
+
+    User(string_view id, string_view username, string_view password, string_view email, string_view name,
+        string_view surname, string_view number, Gender gender, int day, int month, int year, string_view card = "") {
+
+        setId(id);
+        setUsername(username);
+        setPassword(password);
+        setEmail(email);
+        setName(name);
+        setSurname(surname);
+        setDataOfBirth(day, month, year);
+        setGender(gender);
+        setNumber(number);
+        setCard(card);
+    }
+
+    static bool isValidPhoneNumber(string_view number) noexcept { return matchPhoneNumber(number); }
+    static bool isValidEmail(string_view email) noexcept { return matchEmail(email); }
+    static bool isValidId(string_view id) noexcept { return matchUserId(id); }
+
+    // Setters assign in place, so a reused User (see parseUserRow) does not allocate.
+    void setId(string_view id) {
+        if (isValidId(id)) id.copy(this->id, IdLength);
+        else throw string("Invalid ID format!");
+    }
+    void setUsername(string_view username) {
+        if (username.length() >= 8) this->username.assign(username);
+        else throw string("Username must be at least 8 characters!");
+    }
+    void setPassword(string_view password) {
+        if (password.length() >= 8) this->password.assign(password);
+        else throw string("Password must be at least 8 characters!");
+    }
+    void setEmail(string_view email) {
+        if (isValidEmail(email)) this->email.assign(email);
+        else throw string("Invalid email format!");
+    }
+    void setName(string_view name) {
+        if (name.length() >= 2) this->name.assign(name);
+        else throw string("Name must be at least 2 characters!");
+    }
+    void setSurname(string_view surname) {
+        if (surname.length() >= 4) this->surname.assign(surname);
+        else throw string("Surname must be at least 4 characters!");
+    }
+    void setCard(string_view card) { this->card.assign(card); }
+    void setDataOfBirth(int day, int month, int year) {
+        if (year < 1900 || year > 2025) throw string("Invalid year!");
+        if (month < 1 || month > 12) throw string("Invalid month!");
+        int maxDays = 31;
+        switch (month) {
+        case 4: case 6: case 9: case 11: maxDays = 30; break;
+        case 2: maxDays = (year % 4 == 0 ? 29 : 28); break;
+        }
+        if (day < 1 || day > maxDays)
+            throw string("Invalid day for selected month!");
+        birthDay = (uint8_t)day;
+        birthMonth = (uint8_t)month;
+        birthYear = (uint16_t)year;
+        if (getAge() < 18) throw string("User must be at least 18!");
+    }
+    void setGender(Gender g) { gender = (uint8_t)g; }
+    void setNumber(string_view number) {
+        if (isValidPhoneNumber(number))
+            number.copy(this->number, NumberLength);
+        else
+            throw string("Invalid phone number format!");
+    }
+    string_view getId() const noexcept { return string_view(id, IdLength); }
+    string_view getUserName() const noexcept { return username; }
+    string_view getPassword() const noexcept { return password; }
+    string_view getEmail() const noexcept { return email; }
+    string_view getName() const noexcept { return name; }
+    string_view getSurname() const noexcept { return surname; }
+    string_view getNumber() const noexcept { return string_view(number, NumberLength); }
+    string_view getCard() const noexcept { return card; }
+    Gender getGenderValue() const noexcept { return (Gender)gender; }
+    string_view getGender() const noexcept { return gender == Male ? "Male" : "Female"; }
+    int getBirthDay() const noexcept { return birthDay; }
+    int getBirthMonth() const noexcept { return birthMonth; }
+    int getBirthYear() const noexcept { return birthYear; }
+    int getAge() const noexcept { return ageOf(birthDay, birthMonth, birthYear); }
+
+    static int ageOf(int day, int month, int year) noexcept {
+        // localtime() bir yükləmədə milyon dəfə çağırılmasın: tarixi dəqiqədə bir yeniləyirik.
+        thread_local time_t checkedAt = 0;
+        thread_local tm current{};
+        time_t now = time(nullptr);
+        if (now < checkedAt || now - checkedAt >= 60) {
+            toLocalTime(now, current);
+            checkedAt = now;
+        }
+        int age = (current.tm_year + 1900) - year;
+        if ((current.tm_mon + 1 < month) || (current.tm_mon + 1 == month && current.tm_mday < day))
+            age--;
+        return age;
+    }
+
+    friend istream& operator>>(istream& in, User& right) {
+        string id, username, password, email, name, surname, number, gender_str;
+        int day, month, year;
+        cout << "ID: "; in >> id;
+        cout << "Name: "; in >> name;
+        cout << "Surname: "; in >> surname;
+        cout << "Username: "; in >> username;
+        cout << "Password: "; in >> password;
+        cout << "Email: "; in >> email;
+        cout << "Phone (+994...): "; in >> number;
+        cout << "Gender (Male/Female): "; in >> gender_str;
+        cout << "Birthday (Day Month Year): ";
+        in >> day >> month >> year;
+        Gender g;
+        if (gender_str == "Male" || gender_str == "male") g = Male;
+        else if (gender_str == "Female" || gender_str == "female") g = Female;
+        else throw string("Invalid gender!");
+        right = User(id, username, password, email, name, surname, number, g, day, month, year);
+        return in;
+    }
+};
+
+// ==== USER DIRECTORY ====
+// Stored form of a user: the fixed-width fields inline, the six variable
+// strings back to back in the directory's arena starting at `text`.
+// The arena is a list of 1 MiB blocks that never move; a user's strings
+// always share one block.
+struct UserRecord {
+    enum TextField { Username, Password, Email, Name, Surname, Card, TextFieldCount };
+    char id[User::IdLength];
+    char number[User::NumberLength];
+    uint8_t gender;
+    uint8_t day, month;
+    uint16_t year;
+    uint32_t text;                      // arena offset
+    uint16_t length[TextFieldCount];
+};
+
+// Read-only view of a stored user. Valid until the next UserDirectory::add().
+class UserRef {
+    const UserRecord* rec;
+    const char* text;
+
+    string_view field(int f) const noexcept {
+        const char* p = text;
+        for (int i = 0; i < f; i++) p += rec->length[i];
+        return string_view(p, rec->length[f]);
+    }
+public:
+    UserRef(const UserRecord& rec, const char* text) : rec(&rec), text(text) {}
+
+    string_view getId() const noexcept { return string_view(rec->id, User::IdLength); }
+    string_view getUserName() const noexcept { return string_view(text, rec->length[UserRecord::Username]); }
+    string_view getPassword() const noexcept { return field(UserRecord::Password); }
+    string_view getEmail() const noexcept { return field(UserRecord::Email); }
+    string_view getName() const noexcept { return field(UserRecord::Name); }
+    string_view getSurname() const noexcept { return field(UserRecord::Surname); }
+    string_view getCard() const noexcept { return field(UserRecord::Card); }
+    string_view getNumber() const noexcept { return string_view(rec->number, User::NumberLength); }
+    string_view getGender() const noexcept { return rec->gender == Male ? "Male" : "Female"; }
+    int getBirthDay() const noexcept { return rec->day; }
+    int getBirthMonth() const noexcept { return rec->month; }
+    int getBirthYear() const noexcept { return rec->year; }
+    int getAge() const noexcept { return User::ageOf(rec->day, rec->month, rec->year); }
+
+    UserSnapshotRecord toSnapshot(SnapshotWriter& writer) const {
+        UserSnapshotRecord rec{};
+        rec.id = writer.addString(getId());
+        rec.username = writer.addString(getUserName());
+        rec.password = writer.addString(getPassword());
+        rec.email = writer.addString(getEmail());
+        rec.name = writer.addString(getName());
+        rec.surname = writer.addString(getSurname());
+        rec.number = writer.addString(getNumber());
+        rec.card = writer.addString(getCard());
+        rec.gender = this->rec->gender == Female ? 1 : 0;
+        rec.day = this->rec->day;
+        rec.month = this->rec->month;
+        rec.year = this->rec->year;
+        return rec;
+    }
+
+    void ShowUser() const {
+        string text = "\n----------- USER LOGIN INFO -----------\n";
+        text += "Username: "; text += getUserName();
+        text += "\nPassword: "; text += getPassword();
+        text += "\nEmail: "; text += getEmail();
+        text += "\n----------- USER PERSONAL INFO -----------\n";
+        text += "ID: "; text += getId();
+        text += "\nName: "; text += getName();
+        text += "\nSurname: "; text += getSurname();
+        text += "\nBirthday: " + to_string(rec->day) + "/" + to_string(rec->month) + "/" + to_string(rec->year);
+        text += "\nGender: "; text += getGender();
+        text += "\nAge: " + to_string(getAge()) + "\n";
+        writeBlock(cout, text);
+    }
+};
+
+// Open-addressing hash set of user slots, keyed by one field of the user.
+// Holds only slot numbers (4 bytes per entry); keys are read from the
+// directory through keyOf(slot), so nothing is copied.
+class UserKeyIndex {
+    vector<uint32_t> table;  // slot + 1, 0 = empty
+    size_t used = 0;
+
+    template <class KeyOf>
+    void place(uint32_t slot, KeyOf keyOf) {
+        size_t mask = table.size() - 1;
+        size_t i = hash<string_view>()(keyOf(slot)) & mask;
+        while (table[i]) i = (i + 1) & mask;
+        table[i] = slot + 1;
+    }
+public:
+    static constexpr uint32_t None = UINT32_MAX;
+
+    template <class KeyOf>
+    uint32_t find(string_view key, KeyOf keyOf) const {
+        if (table.empty()) return None;
+        size_t mask = table.size() - 1;
+        for (size_t i = hash<string_view>()(key) & mask; table[i]; i = (i + 1) & mask)
+            if (keyOf(table[i] - 1) == key) return table[i] - 1;
+        return None;
+    }
+
+    // The key must not be in the index yet.
+    template <class KeyOf>
+    void insert(uint32_t slot, KeyOf keyOf) {
+        if ((used + 1) * 2 > table.size()) reserve(used + 1, keyOf);
+        place(slot, keyOf);
+        used++;
+    }
+
+    template <class KeyOf>
+    void reserve(size_t count, KeyOf keyOf) {
+        size_t capacity = 16;
+        while (capacity < count * 2) capacity *= 2;
+        if (capacity <= table.size()) return;
+        vector<uint32_t> old(capacity, 0);
+        old.swap(table);
+        for (uint32_t entry : old)
+            if (entry) place(entry - 1, keyOf);
+    }
+
+    void clear() {
+        table.clear();
+        used = 0;
+    }
+};
+
+// All users plus unique indexes on ID, username, email and phone number.
+// Users are only ever appended, so the slots kept in the indexes stay valid.
+class UserDirectory {
+    static constexpr uint32_t BlockBits = 20;
+    static constexpr uint32_t BlockSize = 1u << BlockBits;
+    vector<UserRecord> records;
+    vector<unique_ptr<char[]>> blocks;
+    uint64_t arenaEnd = 0;  // next free arena offset
+    UserKeyIndex byId, byUsername, byEmail, byNumber;
+
+    // Reserves `size` bytes (at most 6 * 64 KiB) inside one block.
+    uint32_t allocateText(size_t size) {
+        uint64_t blockEnd = (uint64_t)blocks.size() << BlockBits;
+        if (arenaEnd + size > blockEnd) {
+            if (blockEnd + size > UINT32_MAX) throw string("User store is full!");
+            blocks.emplace_back(new char[BlockSize]);
+            arenaEnd = blockEnd;
+        }
+        uint32_t offset = (uint32_t)arenaEnd;
+        arenaEnd += size;
+        return offset;
+    }
+
+    auto idOf() const { return [this](uint32_t s) { return string_view(records[s].id, User::IdLength); }; }
+    auto usernameOf() const { return [this](uint32_t s) { return ref(s).getUserName(); }; }
+    auto emailOf() const { return [this](uint32_t s) { return ref(s).getEmail(); }; }
+    auto numberOf() const { return [this](uint32_t s) { return string_view(records[s].number, User::NumberLength); }; }
+
+    UserRef ref(uint32_t slot) const {
+        uint32_t text = records[slot].text;
+        return UserRef(records[slot], blocks.empty() ? "" : blocks[text >> BlockBits].get() + (text & (BlockSize - 1)));
+    }
+
+    optional<UserRef> at(uint32_t slot) const {
+        if (slot == UserKeyIndex::None) return nullopt;
+        return ref(slot);
+    }
+public:
+    // Returns why the user cannot be added, or nullptr if all four keys are free.
+    const char* conflict(const User& user) const {
+        if (byId.find(user.getId(), idOf()) != UserKeyIndex::None) return "ID already exists!";
+        if (byEmail.find(user.getEmail(), emailOf()) != UserKeyIndex::None) return "Email already exists!";
+        if (byNumber.find(user.getNumber(), numberOf()) != UserKeyIndex::None) return "Phone number already exists!";
+        if (byUsername.find(user.getUserName(), usernameOf()) != UserKeyIndex::None) return "Username already exists!";
+        return nullptr;
+    }
+
+    UserRef add(const User& user) {
+        if (const char* why = conflict(user)) throw string(why);
+        string_view text[UserRecord::TextFieldCount] = {
+            user.getUserName(), user.getPassword(), user.getEmail(), user.getName(), user.getSurname(), user.getCard()
+        };
+        size_t total = 0;
+        for (string_view t : text) {
+            if (t.size() > UINT16_MAX) throw string("User field is too long!");
+            total += t.size();
+        }
+        UserRecord rec{};
+        user.getId().copy(rec.id, User::IdLength);
+        user.getNumber().copy(rec.number, User::NumberLength);
+        rec.gender = (uint8_t)user.getGenderValue();
+        rec.day = (uint8_t)user.getBirthDay();
+        rec.month = (uint8_t)user.getBirthMonth();
+        rec.year = (uint16_t)user.getBirthYear();
+        rec.text = allocateText(total);
+        char* out = blocks[rec.text >> BlockBits].get() + (rec.text & (BlockSize - 1));
+        for (int f = 0; f < UserRecord::TextFieldCount; f++) {
+            rec.length[f] = (uint16_t)text[f].size();
+            out = copy(text[f].begin(), text[f].end(), out);
+        }
+        uint32_t slot = (uint32_t)records.size();
+        records.push_back(rec);
+        byId.insert(slot, idOf());
+        byUsername.insert(slot, usernameOf());
+        byEmail.insert(slot, emailOf());
+        byNumber.insert(slot, numberOf());
+        return ref(slot);
+    }
+
+    optional<UserRef> findById(string_view id) const { return at(byId.find(id, idOf())); }
+    optional<UserRef> findByUsername(string_view username) const { return at(byUsername.find(username, usernameOf())); }
+
+    template <class F>
+    void forEach(F f) const {
+        for (uint32_t slot = 0; slot < records.size(); slot++) f(ref(slot));
+    }
+    size_t size() const noexcept { return records.size(); }
+    size_t arenaBytes() const noexcept { return (size_t)arenaEnd; }
+
+    void reserve(size_t count) {
+        records.reserve(count);
+        byId.reserve(count, idOf());
+        byUsername.reserve(count, usernameOf());
+        byEmail.reserve(count, emailOf());
+        byNumber.reserve(count, numberOf());
+    }
+
+    void clear() {
+        records.clear();
+        blocks.clear();
+        arenaEnd = 0;
+        byId.clear();
+        byUsername.clear();
+        byEmail.clear();
+        byNumber.clear();
+    }
+};
+
+class UserManager {
+    UserDirectory users;
+    OrderManager& orderManager;
+    string currentUserId;
+    Admin* adminPtr = nullptr;
+    bool binarySnapshot = false; // User.bin istifadə olunur
+    Persister* persister = nullptr;
+    size_t persistSlot = 0;
+    string pendingRows;          // qeydiyyatlar, hələ User.txt-yə əlavə olunmayıb
+    bool rewriteAll = false;
+public:
+    UserManager(OrderManager& om) : orderManager(om) {
+        binarySnapshot = fs::exists("User.bin");
+        if (!binarySnapshot || !loadUserSnapshot()) loadUserData();
+    }
+
+    void setAdmin(Admin* admin) {
+        adminPtr = admin;
+    }
+
+    void UserPanel() {
+        int choice;
+        do {
+            cout << "\n=== USER PANEL ===\n";
+            cout << "1. Create Order\n";
+            cout << "2. View Order Status\n";
+            cout << "3. View Profile\n";
+            cout << "4. Cancel Order\n";
+            cout << "0. Exit\n";
+            cout << "Choice: ";
+            cin >> choice;
+            if (choice == 1) {
+                if (orderManager.getDishCount() == 0) { cout << "Menu is empty.\n"; continue; }
+                orderManager.showAllDishesWithIndex();
+                int idx;
+                cout << "Enter dish index: ";
+                cin >> idx;
+                try {
+                    string dishName = orderManager.getDishNameByIndex(idx);
+                    uint64_t orderId = orderManager.createOrder(currentUserId, dishName);
+                    cout << "Order #" << orderId << " created!\n";
+                }
+                catch (string ex) { cout << ex << endl; }
+            }
+            else if (choice == 2) {
+                orderManager.showMyOrderStatus(currentUserId);
+            }
+            else if (choice == 3) {
+                if (auto u = users.findById(currentUserId)) u->ShowUser();
+            }
+            else if (choice == 4) {
+                orderManager.showMyOrderStatus(currentUserId);
+                uint64_t orderId;
+                cout << "Enter Order ID to cancel: ";
+                if (cin >> orderId) orderManager.cancelOrder(orderId, currentUserId);
+                else {
+                    cin.clear();
+                    cin.ignore(numeric_limits<streamsize>::max(), '\n');
+                    cout << "Invalid Order ID!\n";
+                }
+            }
+        } while (choice != 0);
+    }
+
+    void signUp(const User& user) {
+        auto data = Persister::lockData(persister);
+        UserRef added = users.add(user);
+        // Mətn formatında yalnız yeni sətir əlavə olunur; .bin isə bütövlükdə yazılır.
+        if (binarySnapshot) saveUserData();
+        else if (persister) {
+            pendingRows += renderUserRow(added);
+            persister->markDirty(persistSlot);
+        }
+        else appendToFile("User.txt", renderUserRow(added));
+        cout << "User registered!\n";
+    }
+
+    static bool isAdminLogin(string username, string password) {
+        for (auto& c : username) c = tolower(c);
+        for (auto& c : password) c = tolower(c);
+        return username == "admin" && password == "admin";
+    }
+
+    void signIn(const string& username, const string& password) {
+        if (isAdminLogin(username, password)) {
+            cout << "Logged in as Admin.\n";
+            if (adminPtr) adminPtr->AdminPanel();
+            else cout << "Admin instance not attached!\n";
+            return;
+        }
+        string userId;
+        if (authenticate(username, password, userId)) {
+            currentUserId = userId;
+            cout << "Login successful!\n";
+            UserPanel();
+            return;
+        }
+        cout << "Wrong username or password!\n";
+    }
+
+    // Checks the credentials without opening a panel; sets userId on success.
+    bool authenticate(const string& username, const string& password, string& userId) const {
+        STATS_TIME(StatSignIn);
+        auto u = users.findByUsername(username);
+        if (!u || u->getPassword() != password) return false;
+        userId = u->getId();
+        return true;
+    }
+
+    // Switches between User.bin and User.txt (see --convert).
+    void setBinarySnapshot(bool on) {
+        binarySnapshot = on;
+        saveUserData();
+        if (!on) {
+            error_code ec;
+            fs::remove("User.bin", ec);
+        }
+    }
+
+    bool loadUserSnapshot(const string& filePath = "User.bin") {
+        users.clear();
+        SnapshotView view;
+        string error = view.open(filePath, SnapshotUsers, sizeof(UserSnapshotRecord));
+        if (!error.empty()) {
+            cout << "Cannot use " << filePath << " (" << error << "), reading text file.\n";
+            return false;
+        }
+        const UserSnapshotRecord* rec = view.records<UserSnapshotRecord>();
+        users.reserve(view.count());
+        for (size_t i = 0; i < view.count(); i++) {
+            User u = User::fromSnapshot(view, rec[i]);
+            if (const char* why = users.conflict(u)) reportMalformedRow(filePath, i + 1, why);
+            else users.add(u);
+        }
+        return true;
+    }
+
+    static void appendUserRow(const UserRef& u, string& out) {
+        for (string_view field : { u.getId(), u.getUserName(), u.getPassword(), u.getEmail(),
+                u.getName(), u.getSurname(), u.getNumber(), u.getGender() }) {
+            out += field;
+            out += '_';
+        }
+        out += to_string(u.getBirthDay()) + "/" + to_string(u.getBirthMonth()) + "/" + to_string(u.getBirthYear()) + "\n";
+    }
+
+    static string renderUserRow(const UserRef& u) {
+        string row;
+        appendUserRow(u, row);
+        return row;
+    }
+
+    const char* usersPath() const noexcept {
+        return binarySnapshot ? "User.bin" : "User.txt";
+    }
+
+    string renderForDisk() const {
+        if (binarySnapshot) {
+            SnapshotWriter writer;
+            users.forEach([&](const UserRef& u) { writer.addRecord(u.toSnapshot(writer)); });
+            return writer.finish(SnapshotUsers, sizeof(UserSnapshotRecord));
+        }
+        string content;
+        content.reserve(users.arenaBytes() + users.size() * 48);
+        users.forEach([&](const UserRef& u) { appendUserRow(u, content); });
+        return content;
+    }
+
+    void saveUserData() {
+        if (persister) {
+            rewriteAll = true;
+            persister->markDirty(persistSlot);
+        }
+        else writeFileAtomically(usersPath(), renderForDisk());
+    }
+
+    // Text mode: new sign-ups are appended in one write per round.
+    void setPersister(Persister* p) {
+        persister = p;
+        persistSlot = p->addStore([this](vector<FileWrite>& writes) {
+            if (binarySnapshot || rewriteAll) writes.emplace_back(usersPath(), renderForDisk());
+            else if (!pendingRows.empty()) writes.emplace_back("User.txt", move(pendingRows), true);
+            pendingRows.clear();
+            rewriteAll = false;
+        });
+    }
+
+    // Rows that reuse an ID, username, email or phone number are reported and skipped.
+    void loadUserData() {
+        users.clear();
+        LineReader reader("User.txt");
+        if (!reader.isOpen()) {
+            ofstream create("User.txt");
+            create.close();
+            return;
+        }
+        string_view row;
+        string error;
+        User u; // hər sətirdə təkrar istifadə olunur
+        while (reader.next(row)) {
+            if (row.empty()) continue;
+            if (!parseUserRow(row, u, error)) reportMalformedRow("User.txt", reader.lineNumber(), error);
+            else if (const char* why = users.conflict(u)) reportMalformedRow("User.txt", reader.lineNumber(), why);
+            else users.add(u);
+        }
+    }
+
+    // Parses id_username_password_email_name_surname_number_gender_d/m/y (User.txt row format).
+    // Fields are assigned into `out`, so reusing it for many rows does not allocate.
+    static bool parseUserRow(string_view row, User& out, string& error) {
+        STATS_TIME(StatUserParse);
+        string_view f[9]; // id, username, password, email, name, surname, number, gender, date
+        FieldSplitter split(row);
+        size_t n = 0;
+        while (n < 8 && split.next(f[n])) n++;
+        f[8] = split.remainder();
+        FieldSplitter date(f[8], '/');
+        string_view dayStr, monthStr, yearStr;
+        int day = 0, month = 0, year = 0;
+        if (n < 8 || !date.next(dayStr) || !date.next(monthStr) || !date.next(yearStr)
+            || !parseNumber(dayStr, day) || !parseNumber(monthStr, month) || !parseNumber(yearStr, year)) {
+            error = "expected 8 fields and d/m/y";
+            return false;
+        }
+        Gender g = (f[7] == "Male" ? Male : Female);
+        try {
+            out.setId(f[0]);
+            out.setUsername(f[1]);
+            out.setPassword(f[2]);
+            out.setEmail(f[3]);
+            out.setName(f[4]);
+            out.setSurname(f[5]);
+            out.setDataOfBirth(day, month, year);
+            out.setGender(g);
+            out.setNumber(f[6]);
+            out.setCard("");
+            return true;
+        }
+        catch (const string& ex) {
+            error = ex;
+            return false;
+        }
     }
-    ~OrderManager() {
-        saveOrders();
+};
+
+// Swallows the messages printed by the business logic in the headless modes.
+struct NullBuffer : streambuf {
+    int overflow(int c) override { return c; }
+    streamsize xsputn(const char*, streamsize n) override { return n; }
+};
+
+// ==== SCRIPT RUNNER ====
+// Non-interactive mode: runs a command stream against the same Stock,
+// OrderManager, Admin and UserManager objects as the menus, then prints
+// per-command latency and overall throughput. One command per line,
+// fields separated by '_' like the data files; '#' starts a comment:
+//   signup_<User.txt row>          signin_<username>_<password>
+//   order_<dish name>              (for the signed-in user)
+//   advance_<order id>|#<n>        (#n = n-th order created by this script)
+//   restock_<ingredient>_<amount>  adddish_<Dishes.txt row>
+//   sync                           (waits until every change so far is on disk)
+// With setKitchens() orders, advances, restocks and syncs go to the kitchen
+// shards instead (sign-ups and the menu stay central).
+class ScriptRunner {
+    enum Command { CmdSignUp, CmdSignIn, CmdOrder, CmdAdvance, CmdRestock, CmdAddDish, CmdSync, CmdCount };
+
+    struct CommandStats {
+        vector<double> micros;
+        size_t failures = 0;
+    };
+
+    Stock& stock;
+    OrderManager& orderManager;
+    Admin& admin;
+    UserManager& userManager;
+    Persister* persister;
+    KitchenShards* kitchens = nullptr;
+    string sessionUserId;
+    vector<uint64_t> createdOrders;
+    CommandStats stats[CmdCount];
+
+    static const char* commandName(int cmd) {
+        static const char* names[CmdCount] = { "signup", "signin", "order", "advance", "restock", "adddish", "sync" };
+        return names[cmd];
     }
 
-    void bindDishList(vector<Dish>* dishes) {
-        dishesRef = dishes;
+    static int parseCommand(string_view name) {
+        for (int c = 0; c < CmdCount; c++)
+            if (name == commandName(c)) return c;
+        return -1;
     }
 
-    int getDishCount() const {
-        return dishesRef ? dishesRef->size() : 0;
+    bool execute(int cmd, string_view args, string& error) {
+        switch (cmd) {
+        case CmdSignUp: {
+            User u;
+            if (!UserManager::parseUserRow(args, u, error)) return false;
+            userManager.signUp(u);
+            return true;
+        }
+        case CmdSignIn: {
+            size_t pos = args.find('_');
+            if (pos == string_view::npos) { error = "expected username_password"; return false; }
+            if (!userManager.authenticate(string(args.substr(0, pos)), string(args.substr(pos + 1)), sessionUserId)) {
+                error = "Wrong username or password!";
+                return false;
+            }
+            return true;
+        }
+        case CmdOrder:
+            if (sessionUserId.empty()) { error = "not signed in"; return false; }
+            createdOrders.push_back(kitchens ? kitchens->createOrder(sessionUserId, string(args))
+                : orderManager.createOrder(sessionUserId, string(args)));
+            return true;
+        case CmdAdvance: {
+            uint64_t id = 0;
+            if (!args.empty() && args[0] == '#') {
+                size_t n = 0;
+                if (!parseNumber(args.substr(1), n) || n == 0 || n > createdOrders.size()) {
+                    error = "no such script order";
+                    return false;
+                }
+                id = createdOrders[n - 1];
+            }
+            else if (!parseNumber(args, id)) { error = "bad order id"; return false; }
+            auto result = kitchens ? kitchens->advanceOrder(id) : orderManager.advanceOrders({ id })[0];
+            if (!result.ok) error = result.message;
+            return result.ok;
+        }
+        case CmdRestock: {
+            size_t pos = args.find('_');
+            double amount = 0;
+            if (pos == string_view::npos || !parseNumber(args.substr(pos + 1), amount)) {
+                error = "expected name_amount";
+                return false;
+            }
+            if (kitchens) kitchens->restock(string(args.substr(0, pos)), amount);
+            else stock.addIngredient(Ingredient(string(args.substr(0, pos)), amount));
+            return true;
+        }
+        case CmdAddDish: {
+            Dish d;
+            if (!Admin::parseDishRow(args, d, error)) return false;
+            admin.addDish(move(d));
+            if (kitchens) kitchens->setMenu(admin.getDishes());
+            return true;
+        }
+        case CmdSync:
+            if (persister) persister->sync();
+            if (kitchens) kitchens->sync();
+            return true;
+        }
+        return false;
     }
 
-    string getDishNameByIndex(int index) const {
-        if (!dishesRef) throw string("Dish list is not loaded!");
-        if (index < 0 || index >= dishesRef->size())
-            throw string("Invalid dish index!");
-        return (*dishesRef)[index].getName();
+public:
+    static double percentile(const vector<double>& sorted, double p) {
+        if (sorted.empty()) return 0;
+        size_t idx = (size_t)(p * (sorted.size() - 1) + 0.5);
+        return sorted[idx];
     }
 
-    void showAllDishes() const {
-        if (!dishesRef) { cout << "Dish list not loaded!\n"; return; }
-        for (auto& d : *dishesRef) {
-            d.show();
-            cout << "------------------------\n";
+    ScriptRunner(Stock& stock, OrderManager& om, Admin& admin, UserManager& um, Persister* persister = nullptr)
+        : stock(stock), orderManager(om), admin(admin), userManager(um), persister(persister) {
+    }
+
+    void setKitchens(KitchenShards* k) { kitchens = k; }
+
+    // Returns the process exit code (0 unless the script could not be read).
+    int run(const string& path) {
+        LineReader reader(path);
+        if (!reader.isOpen()) {
+            cout << "Cannot open script: " << path << "\n";
+            return 1;
+        }
+        NullBuffer nullBuffer;
+        streambuf* console = cout.rdbuf(&nullBuffer);
+        ostream report(console);
+        vector<string> errors;
+        size_t total = 0;
+        string error;
+        string_view line;
+        auto start = chrono::steady_clock::now();
+        while (reader.next(line)) {
+            if (line.empty() || line[0] == '#') continue;
+            size_t pos = line.find('_');
+            int cmd = parseCommand(line.substr(0, pos));
+            string_view args = pos == string_view::npos ? string_view() : line.substr(pos + 1);
+            if (cmd < 0) {
+                if (errors.size() < 10) errors.push_back("line " + to_string(reader.lineNumber()) + ": unknown command");
+                continue;
+            }
+            error.clear();
+            auto t0 = chrono::steady_clock::now();
+            bool ok;
+            try { ok = execute(cmd, args, error); }
+            catch (const string& ex) { ok = false; error = ex; }
+            auto t1 = chrono::steady_clock::now();
+            stats[cmd].micros.push_back(chrono::duration<double, micro>(t1 - t0).count());
+            total++;
+            if (!ok) {
+                stats[cmd].failures++;
+                if (errors.size() < 10) errors.push_back("line " + to_string(reader.lineNumber()) + ": " + error);
+            }
+        }
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        cout.rdbuf(console);
+
+        report << "command      count   failed     avg us     p50 us     p99 us     max us\n";
+        for (int c = 0; c < CmdCount; c++) {
+            vector<double>& m = stats[c].micros;
+            if (m.empty()) continue;
+            sort(m.begin(), m.end());
+            double sum = 0;
+            for (double v : m) sum += v;
+            char row[160];
+            snprintf(row, sizeof(row), "%-10s %7zu %8zu %10.1f %10.1f %10.1f %10.1f\n", commandName(c),
+                m.size(), stats[c].failures, sum / m.size(), percentile(m, 0.5), percentile(m, 0.99), m.back());
+            report << row;
         }
+        report << "Total: " << total << " commands in " << seconds << " s, "
+            << (seconds > 0 ? total / seconds : 0) << " ops/sec\n";
+        for (const auto& e : errors) report << "  " << e << "\n";
+        return 0;
     }
 
-    void showAllDishesWithIndex() const {
-        if (!dishesRef) { cout << "Dish list not loaded!\n"; return; }
-        cout << "\n===== MENU =====\n";
-        for (size_t i = 0; i < dishesRef->size(); i++)
-            cout << i << ") " << (*dishesRef)[i].getName()
-            << "  Price: " << (*dishesRef)[i].getPrice() << endl;
-        cout << "================\n";
-    }
-
-    void createOrder(const string& userId, const string& dishName) {
-        orders.push_back(Order(userId, dishName, (int)Received));
-        saveOrders();
-    }
-
-    void moveOrderForward(const string& userId) {
-        for (auto& ord : orders) {
-            if (ord.userId == userId) {
-                // DƏYİŞİKLİK: Stock RECEIVED-də azaldılsın
-                if (ord.status == Received) {
-                    if (!dishesRef) {
-                        cout << "Dish list is not loaded!\n";
-                        return;
-                    }
-                    Dish* targetDish = nullptr;
-                    for (auto& d : *dishesRef) {
-                        if (d.getName() == ord.dishName) {
-                            targetDish = &d;
-                            break;
-                        }
-                    }
-                    if (!targetDish) {
-                        cout << "Dish does not exist in the menu!\n";
-                        return;
-                    }
-                    try {
-                        stock.useIngredient(*targetDish);
-                    }
-                    catch (const string& ex) {
-                        cout << ex << endl;
-                        cout << "Order cannot move to Preparing stage!\n";
-                        return;
-                    }
+    // Writes a reproducible workload: restocks, M dishes, N sign-ups, then K
+    // orders interleaved with the advances that take each order to Ready.
+    // Unique 7-character ID of the u-th generated user: 'U' + 6 base36 digits.
+    static string generatedUserId(size_t u) {
+        static const char digits[] = "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ";
+        string id = "U000000";
+        for (int k = 6; k >= 1; k--, u /= 36) id[k] = digits[u % 36];
+        return id;
+    }
+
+    // Phone numbers are unique too: 10M per operator code.
+    static constexpr const char* phoneCodes[] = { "50", "51", "55", "70", "77", "10", "99" };
+    static constexpr size_t maxGeneratedUsers = 7 * 10000000ull;
+
+    static bool generate(uint32_t seed, size_t users, size_t dishes, size_t orders, const string& outPath) {
+        if (users > maxGeneratedUsers)
+            throw string("At most " + to_string(maxGeneratedUsers) + " users can be generated!");
+        ofstream out(outPath, ios::binary | ios::trunc);
+        if (!out.is_open()) return false;
+        mt19937 rng(seed);
+        size_t ingredients = max<size_t>(5, dishes);
+        char buf[256];
+        out << "# generated: seed " << seed << ", " << users << " users, " << dishes
+            << " dishes, " << orders << " orders\n";
+        for (size_t i = 0; i < ingredients; i++) {
+            snprintf(buf, sizeof(buf), "restock_ing%05zu_%zu\n", i, orders * 4 + 100);
+            out << buf;
+        }
+        for (size_t d = 0; d < dishes; d++) {
+            snprintf(buf, sizeof(buf), "adddish_Dish%05zu_Generated dish_%zu", d, 3 + rng() % 20);
+            out << buf;
+            size_t count = 1 + rng() % 4;
+            for (size_t k = 0; k < count; k++) {
+                snprintf(buf, sizeof(buf), "_ing%05zu:%.1f", (size_t)(rng() % ingredients), 0.5 + (rng() % 6) * 0.5);
+                out << buf;
+            }
+            out << "\n";
+        }
+        for (size_t u = 0; u < users; u++) {
+            snprintf(buf, sizeof(buf), "signup_%s_user%06zu_pass%06zu_user%06zu@gmail.com_Name_Surname_+994%s%07zu_%s_%d/%d/%d\n",
+                generatedUserId(u).c_str(), u, u, u, phoneCodes[u / 10000000], u % 10000000, u % 2 ? "Female" : "Male",
+                1 + (int)(rng() % 28), 1 + (int)(rng() % 12), 1950 + (int)(rng() % 50));
+            out << buf;
+        }
+        // Sifarişlər və irəliləmələr qarışıq gəlir, hər sifariş 4 addımda Ready olur.
+        vector<pair<size_t, int>> open; // (script order number, advances done)
+        size_t created = 0;
+        while (created < orders || !open.empty()) {
+            bool create = created < orders && (open.empty() || rng() % 2 == 0);
+            if (create && users > 0 && dishes > 0) {
+                size_t u = rng() % users;
+                snprintf(buf, sizeof(buf), "signin_user%06zu_pass%06zu\norder_Dish%05zu\n", u, u, (size_t)(rng() % dishes));
+                out << buf;
+                open.push_back({ ++created, 0 });
+            }
+            else if (!open.empty()) {
+                size_t pick = rng() % open.size();
+                out << "advance_#" << open[pick].first << "\n";
+                if (++open[pick].second == 4) {
+                    open[pick] = open.back();
+                    open.pop_back();
                 }
-                if (ord.status < Ready)
-                    ord.status = (OrderStatus)(ord.status + 1);
-                saveOrders();
-                if (ord.status == Ready)
-                    cout << "Order is ready for pickup!\n";
-                else
-                    cout << "Order progressed to status: " << statusToString(ord.status) << endl;
-                return;
             }
+            else break;
         }
-        cout << "Order not found!\n";
+        return (bool)out;
     }
+};
 
-    void showMyOrderStatus(const string& userId) const {
-        for (auto& ord : orders) {
-            if (ord.userId == userId) {
-                cout << "Dish: " << ord.dishName << " | Status: " << statusToString(ord.status) << endl;
-                return;
+// ==== ORDER SERVER ====
+// TCP front end on 127.0.0.1 for the same managers the menus use. One
+// request per line in the script format ('_' between fields), one answer
+// line per request, "OK ..." or "ERR <message>":
+//   signin_<username>_<password>  -> OK <user id> | OK admin
+//   menu                          -> OK <index>:<name>:<price>[:sold out], tab separated
+//   order_<dish name>             -> OK <order id>
+//   status                        -> OK <id>:<dish>:<status>, tab separated (own orders)
+//   status_<order id>             -> OK <status>
+//   history[_<count>]             -> OK <id>:<dish>:<status>:<created>, tab separated,
+//                                    archived orders newest first (own; admin: all)
+//   advance_<order id>            -> OK <new status> (admin only)
+//   quit
+// One thread serves every connection with epoll (Linux only). A peer that
+// pipelines requests without reading the answers is not read from while more
+// than 1 MiB of answers wait for it. --load is the
+// matching client: many connections, each sending its next request when the
+// previous answer arrives, then latency percentiles and requests per second.
+#ifdef __linux__
+static atomic<bool> serverStop{ false };
+
+static void onStopSignal(int) { serverStop = true; }
+
+// Thousands of sockets need more than the usual 1024 descriptors.
+static void raiseFileLimit() {
+    rlimit limit;
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur < limit.rlim_max) {
+        limit.rlim_cur = limit.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &limit);
+    }
+}
+
+class OrderServer {
+    struct Connection {
+        bool open = false;
+        bool closing = false;   // close once `out` is sent
+        bool paused = false;    // requests wait until `out` is sent
+        bool peerClosed = false;
+        uint32_t events = 0;    // registered with epoll
+        bool admin = false;
+        string userId;          // signed-in user
+        string in;
+        string out;
+        size_t sent = 0;
+    };
+
+    OrderManager& orderManager;
+    UserManager& userManager;
+    Admin& admin;
+    int listenFd = -1;
+    int epollFd = -1;
+    vector<Connection> connections;     // by descriptor
+    static const size_t maxLine = 4096;
+    static const size_t maxPendingOut = 1 << 20;
+
+    void watch(int fd, uint32_t events, int op) {
+        epoll_event ev{};
+        ev.events = events;
+        ev.data.fd = fd;
+        epoll_ctl(epollFd, op, fd, &ev);
+    }
+
+    void acceptAll() {
+        for (;;) {
+            int fd = accept4(listenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+            if (fd < 0) return; // EAGAIN, or out of descriptors until some close
+            int one = 1;
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+            if ((size_t)fd >= connections.size()) connections.resize(fd + 1);
+            connections[fd] = Connection();
+            connections[fd].open = true;
+            connections[fd].events = EPOLLIN;
+            watch(fd, EPOLLIN, EPOLL_CTL_ADD);
+        }
+    }
+
+    void closeConnection(int fd) {
+        epoll_ctl(epollFd, EPOLL_CTL_DEL, fd, nullptr);
+        close(fd);
+        connections[fd] = Connection();
+    }
+
+    static bool parseId(string_view text, uint64_t& id) {
+        return parseNumber(text, id) && id > 0;
+    }
+
+    void menu(string& out) {
+        const vector<Dish>& dishes = admin.getDishes();
+        out += "OK";
+        for (size_t i = 0; i < dishes.size(); i++) {
+            out += i ? '\t' : ' ';
+            out += to_string(i) + ":" + dishes[i].getName() + ":";
+            appendNumber(out, dishes[i].getPrice());
+            if (orderManager.servingsAvailable(i) == 0) out += ":sold out";
+        }
+        out += '\n';
+    }
+
+    void status(Connection& c, string_view args) {
+        if (args.empty()) {
+            if (c.userId.empty()) throw string("Sign in as a user first!");
+            c.out += "OK";
+            bool first = true;
+            for (const Order& ord : orderManager.ordersOfUser(c.userId)) {
+                c.out += first ? ' ' : '\t';
+                c.out += to_string(ord.id) + ":" + ord.dishName + ":" + OrderManager::statusToString(ord.status);
+                first = false;
             }
+            c.out += '\n';
+            return;
         }
-        cout << "You have no active orders.\n";
+        uint64_t id;
+        Order ord(0, "", "");
+        if (!parseId(args, id)) throw string("Invalid order ID!");
+        if (!orderManager.findOrder(id, ord) || (!c.admin && ord.userId != c.userId)) throw string("Order not found!");
+        c.out += "OK " + OrderManager::statusToString(ord.status) + "\n";
     }
 
-    void showAllOrders() const {
-        cout << "\nCurrent Orders:\n";
-        bool any = false;
-        for (const auto& ord : orders) {
-            cout << "UserID: " << ord.userId << ", Dish: " << ord.dishName
-                << ", Status: " << statusToString(ord.status) << endl;
-            any = true;
+    void history(Connection& c, string_view args) {
+        if (c.userId.empty() && !c.admin) throw string("Sign in first!");
+        ArchiveQuery query;
+        query.userId = c.userId;
+        query.limit = 20;
+        if (!args.empty() && (!parseNumber(args, query.limit) || query.limit == 0 || query.limit > 1000))
+            throw string("Invalid count!");
+        c.out += "OK";
+        bool first = true;
+        for (const Order& ord : orderManager.orderHistory(query)) {
+            c.out += first ? ' ' : '\t';
+            c.out += to_string(ord.id) + ":" + ord.dishName + ":" + OrderManager::statusToString(ord.status)
+                + ":" + to_string(ord.createdAt);
+            first = false;
         }
-        if (!any)
-            cout << "(No orders found)\n";
+        c.out += '\n';
     }
 
-    // -- Orders Faylda SAXLA/oxu --
-    void saveOrders(const string& filePath = "Orders.txt") {
-        ofstream fs(filePath);
-        if (!fs.is_open()) return;
-        for (const auto& order : orders)
-            fs << order.toString() << endl;
-        fs.close();
+    void handle(Connection& c, string_view line) {
+        STATS_TIME(StatServerRequest);
+        size_t pos = line.find('_');
+        string_view cmd = line.substr(0, pos);
+        string_view args = pos == string_view::npos ? string_view() : line.substr(pos + 1);
+        try {
+            if (cmd == "signin") {
+                size_t sep = args.find('_');
+                if (sep == string_view::npos) throw string("expected signin_<username>_<password>");
+                string username(args.substr(0, sep)), password(args.substr(sep + 1));
+                c.admin = UserManager::isAdminLogin(username, password);
+                c.userId.clear();
+                if (!c.admin && !userManager.authenticate(username, password, c.userId))
+                    throw string("Wrong username or password!");
+                c.out += c.admin ? "OK admin\n" : "OK " + c.userId + "\n";
+            }
+            else if (cmd == "menu") menu(c.out);
+            else if (cmd == "order") {
+                if (c.userId.empty()) throw string("Sign in as a user first!");
+                c.out += "OK " + to_string(orderManager.createOrder(c.userId, string(args))) + "\n";
+            }
+            else if (cmd == "status") status(c, args);
+            else if (cmd == "history") history(c, args);
+            else if (cmd == "advance") {
+                uint64_t id;
+                if (!c.admin) throw string("Only the admin can advance orders!");
+                if (!parseId(args, id)) throw string("Invalid order ID!");
+                auto result = orderManager.advanceOrders({ id })[0];
+                c.out += (result.ok ? "OK " : "ERR ") + result.message + "\n";
+            }
+            else if (cmd == "quit") {
+                c.out += "OK bye\n";
+                c.closing = true;
+            }
+            else throw string("Unknown command!");
+        }
+        catch (const string& ex) {
+            c.out += "ERR " + ex + "\n";
+        }
     }
-    void loadOrders(const string& filePath = "Orders.txt") {
-        orders.clear();
-        ifstream fs(filePath);
-        if (!fs.is_open()) return;
-        string line;
-        while (getline(fs, line)) {
-            if (!line.empty())
-                orders.push_back(Order::fromString(line));
+
+    // EPOLLIN is off while the connection is paused, EPOLLOUT is on while
+    // `out` has bytes the socket did not take.
+    void updateEvents(int fd) {
+        Connection& c = connections[fd];
+        uint32_t events = (c.paused ? 0u : (uint32_t)EPOLLIN) | (c.sent < c.out.size() ? (uint32_t)EPOLLOUT : 0u);
+        if (events != c.events) watch(fd, events, EPOLL_CTL_MOD);
+        c.events = events;
+    }
+
+    // Answers the complete lines in `in`. Once more than maxPendingOut bytes
+    // of answers are unsent, the rest waits until flush() has sent them all.
+    void handleLines(Connection& c) {
+        // Ardıcıl gələn (pipelined) sorğuların hamısını emal edirik.
+        size_t start = 0, end = 0;
+        while (!c.closing && !c.paused && (end = c.in.find('\n', start)) != string::npos) {
+            string_view line(c.in.data() + start, end - start);
+            if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+            if (!line.empty()) handle(c, line);
+            start = end + 1;
+            c.paused = c.out.size() - c.sent > maxPendingOut;
+        }
+        c.in.erase(0, start);
+        if (end == string::npos && c.in.size() > maxLine) {
+            c.out += "ERR Request line too long!\n";
+            c.closing = true;
         }
-        fs.close();
+        if (c.peerClosed && !c.paused) c.closing = true;
     }
-};
 
-// ==== ADMIN CLASS ====
-class Admin {
-    Stock stock;
-    vector<Dish> dishes;
-    OrderManager& orderManager;
+    // Sends what the socket takes; the rest waits for EPOLLOUT.
+    void flush(int fd) {
+        Connection& c = connections[fd];
+        for (;;) {
+            while (c.sent < c.out.size()) {
+                ssize_t n = send(fd, c.out.data() + c.sent, c.out.size() - c.sent, MSG_NOSIGNAL);
+                if (n > 0) { c.sent += n; continue; }
+                if (n < 0 && errno == EINTR) continue;
+                if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                    updateEvents(fd);
+                    return;
+                }
+                closeConnection(fd);
+                return;
+            }
+            c.out.clear();
+            c.sent = 0;
+            if (!c.paused) break;
+            // Hamısı göndərildi: gözləyən sorğulara indi cavab veririk.
+            c.paused = false;
+            handleLines(c);
+        }
+        if (c.closing) { closeConnection(fd); return; }
+        updateEvents(fd);
+    }
+
+    void readFrom(int fd) {
+        Connection& c = connections[fd];
+        char buf[16384];
+        while (!c.peerClosed && c.in.size() < maxPendingOut) {
+            ssize_t n = recv(fd, buf, sizeof(buf), 0);
+            if (n > 0) { c.in.append(buf, n); continue; }
+            if (n < 0 && errno == EINTR) continue;
+            c.peerClosed = n == 0 || (errno != EAGAIN && errno != EWOULDBLOCK);
+            break;
+        }
+        handleLines(c);
+        flush(fd);
+    }
 public:
-    Admin(OrderManager& om) : orderManager(om) {
-        loadAllData();
-        orderManager.bindDishList(&dishes);
+    OrderServer(OrderManager& om, UserManager& um, Admin& admin) : orderManager(om), userManager(um), admin(admin) {}
+    OrderServer(const OrderServer&) = delete;
+    OrderServer& operator=(const OrderServer&) = delete;
+    ~OrderServer() {
+        for (size_t fd = 0; fd < connections.size(); fd++)
+            if (connections[fd].open) close((int)fd);
+        if (epollFd >= 0) close(epollFd);
+        if (listenFd >= 0) close(listenFd);
     }
 
-    void AdminPanel() {
-        int choice;
-        do {
-            cout << "\n=== ADMIN PANEL ===\n";
-            cout << "1. Add new dish\n";
-            cout << "2. Edit dish\n";
-            cout << "3. Delete dish\n";
-            cout << "4. Show all dishes\n";
-            cout << "5. Add ingredient to stock\n";
-            cout << "6. Show stock\n";
-            cout << "7. Move order status forward\n";
-            cout << "8. Show all orders\n";
-            cout << "0. Exit\n";
-            cout << "Choice: ";
-            cin >> choice;
+    // Serves until SIGINT/SIGTERM; returns the process exit code.
+    int run(uint16_t port) {
+        raiseFileLimit();
+        listenFd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        int one = 1;
+        setsockopt(listenFd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(port);
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        if (listenFd < 0 || ::bind(listenFd, (sockaddr*)&addr, sizeof(addr)) < 0 || listen(listenFd, SOMAXCONN) < 0) {
+            cout << "Cannot listen on 127.0.0.1:" << port << ": " << strerror(errno) << "\n";
+            return 1;
+        }
+        epollFd = epoll_create1(EPOLL_CLOEXEC);
+        watch(listenFd, EPOLLIN, EPOLL_CTL_ADD);
+        signal(SIGPIPE, SIG_IGN);
+        signal(SIGINT, onStopSignal);
+        signal(SIGTERM, onStopSignal);
+        cout << "Serving on 127.0.0.1:" << port << " (Ctrl+C stops)" << endl;
 
-            if (choice == 7) {
-                orderManager.showAllOrders();
-                string userId;
-                cout << "Enter User ID: ";
-                cin >> userId;
-                orderManager.moveOrderForward(userId);
-                continue;
+        epoll_event events[256];
+        while (!serverStop) {
+            int n = epoll_wait(epollFd, events, 256, 200);
+            if (n < 0 && errno != EINTR) {
+                cout << "epoll_wait: " << strerror(errno) << "\n";
+                return 1;
             }
-            if (choice == 8) {
-                orderManager.showAllOrders();
-                continue;
-            }
-            switch (choice) {
-            case 1: addDish(); break;
-            case 2: updateDish(); break;
-            case 3: deleteDish(); break;
-            case 4: showAllDishes(); break;
-            case 5: addIngredientToStock(); break;
-            case 6: showStock(); break;
-            case 0: cout << "Exiting admin panel...\n"; break;
-            default: cout << "Invalid choice!\n"; break;
+            for (int i = 0; i < n; i++) {
+                int fd = events[i].data.fd;
+                if (fd == listenFd) { acceptAll(); continue; }
+                if (!connections[fd].open) continue;
+                if (events[i].events & (EPOLLIN | EPOLLERR | EPOLLHUP)) readFrom(fd);
+                else if (events[i].events & EPOLLOUT) flush(fd);
             }
-        } while (choice != 0);
+        }
+        cout << "Server stopped.\n";
+        return 0;
     }
+};
 
-    void addDish() {
-        try {
-            string name, description;
-            double price;
-            int ingCount;
+// Closed-loop load generator for OrderServer: every connection signs in,
+// then repeats menu / order / status until it has sent `requests` requests.
+class LoadClient {
+    enum Request { SignIn, Status, Menu, Place };
 
-            cin.ignore(numeric_limits<streamsize>::max(), '\n');
-            cout << "Enter dish name: ";
-            getline(cin, name);
-            cout << "Enter dish description: ";
-            getline(cin, description);
-            cout << "Enter dish price: ";
-            cin >> price;
-            cin.ignore(numeric_limits<streamsize>::max(), '\n');
+    struct Session {
+        int fd = -1;
+        bool connected = false;
+        Request kind = SignIn;      // what is in flight
+        size_t done = 0;            // answered requests
+        string in;
+        string pending;             // request not fully sent yet
+        uint64_t lastOrder = 0;
+        chrono::steady_clock::time_point sentAt;
+    };
 
-            Dish d(name, description, price);
+    uint16_t port;
+    size_t requests;
+    string username, password;
+    int epollFd = -1;
+    vector<Session> sessions;
+    vector<string> dishes;          // from the first menu answer
+    vector<double> micros;
+    size_t errors = 0;
+    size_t dropped = 0;             // connections lost before finishing
+    size_t active = 0;
 
-            cout << "How many ingredients?: ";
-            cin >> ingCount;
-            cin.ignore(numeric_limits<streamsize>::max(), '\n');
+    string nextRequest(size_t index, Session& s) {
+        s.kind = s.done == 0 ? SignIn : (Request)(1 + s.done % 3);
+        if (s.kind == Place && dishes.empty()) s.kind = Menu;
+        switch (s.kind) {
+        case SignIn: return "signin_" + username + "_" + password + "\n";
+        case Status: return s.lastOrder ? "status_" + to_string(s.lastOrder) + "\n" : "status\n";
+        case Menu: return "menu\n";
+        default: return "order_" + dishes[(index + s.done) % dishes.size()] + "\n";
+        }
+    }
 
-            for (int i = 0; i < ingCount; i++) {
-                string ingName; double ingAmount;
-                cout << "Ingredient " << i + 1 << " name: ";
-                getline(cin, ingName);
-                cout << "Amount: ";
-                cin >> ingAmount;
-                cin.ignore(numeric_limits<streamsize>::max(), '\n');
-                d.addIngredient(Ingredient(ingName, ingAmount));
-            }
+    void finish(Session& s, bool completed) {
+        if (s.fd < 0) return;
+        epoll_ctl(epollFd, EPOLL_CTL_DEL, s.fd, nullptr);
+        close(s.fd);
+        s.fd = -1;
+        active--;
+        if (!completed) dropped++;
+    }
 
-            dishes.push_back(d);
-            saveAllData();
-            cout << "Dish successfully added!\n";
+    void send(size_t index, Session& s) {
+        if (s.pending.empty()) {
+            s.pending = nextRequest(index, s);
+            s.sentAt = chrono::steady_clock::now();
         }
-        catch (string ex) { cout << ex << endl; }
+        ssize_t n = ::send(s.fd, s.pending.data(), s.pending.size(), MSG_NOSIGNAL);
+        if (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK) { finish(s, false); return; }
+        s.pending.erase(0, n < 0 ? 0 : n);
+        epoll_event ev{};
+        ev.events = s.pending.empty() ? EPOLLIN : EPOLLIN | EPOLLOUT;
+        ev.data.u64 = index;
+        epoll_ctl(epollFd, EPOLL_CTL_MOD, s.fd, &ev);
     }
 
-    void updateDish() {
-        try {
-            if (dishes.empty()) { cout << "No dishes available.\n"; return; }
-            cin.ignore(numeric_limits<streamsize>::max(), '\n');
-            string name;
-            cout << "Enter dish name to edit: ";
-            getline(cin, name);
+    void answer(Session& s, string_view line) {
+        micros.push_back(chrono::duration<double, micro>(chrono::steady_clock::now() - s.sentAt).count());
+        if (line.substr(0, 3) != "OK ") errors++;
+        else if (s.kind == Place) parseNumber(line.substr(3), s.lastOrder);
+        else if (s.kind == Menu && dishes.empty()) {
+            // "OK 0:Plov:10\t1:Soup:5:sold out" -> dish names
+            for (string_view rest = line.substr(3); !rest.empty();) {
+                size_t tab = rest.find('\t');
+                string_view item = rest.substr(0, tab);
+                size_t a = item.find(':'), b = item.find(':', a + 1);
+                if (a != string_view::npos && b != string_view::npos) dishes.emplace_back(item.substr(a + 1, b - a - 1));
+                rest = tab == string_view::npos ? string_view() : rest.substr(tab + 1);
+            }
+        }
+        s.done++;
+    }
 
-            for (auto& d : dishes) {
-                if (d.getName() == name) {
-                    string newDesc; double newPrice;
-                    cout << "New description: ";
-                    getline(cin, newDesc);
-                    cout << "New price: ";
-                    cin >> newPrice;
-                    cin.ignore(numeric_limits<streamsize>::max(), '\n');
-                    d.setDescription(newDesc);
-                    d.setPrice(newPrice);
-                    saveAllData();
-                    cout << "Dish updated!\n";
-                    return;
+    void readFrom(size_t index, Session& s) {
+        char buf[16384];
+        for (;;) {
+            ssize_t n = recv(s.fd, buf, sizeof(buf), 0);
+            if (n > 0) { s.in.append(buf, n); continue; }
+            if (n == 0 || (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)) { finish(s, false); return; }
+            break;
+        }
+        size_t end = s.in.find('\n');
+        if (end == string::npos) return;
+        answer(s, string_view(s.in.data(), end));
+        s.in.erase(0, end + 1);
+        if (s.done > requests) finish(s, true);  // sign-in is not one of `requests`
+        else send(index, s);
+    }
+public:
+    LoadClient(uint16_t port, size_t requests, string username, string password)
+        : port(port), requests(requests), username(move(username)), password(move(password)) {
+    }
+
+    int run(size_t connections) {
+        raiseFileLimit();
+        signal(SIGPIPE, SIG_IGN);
+        epollFd = epoll_create1(EPOLL_CLOEXEC);
+        sessions.resize(connections);
+        micros.reserve(connections * (requests + 1));
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(port);
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        auto start = chrono::steady_clock::now();
+        for (size_t i = 0; i < connections; i++) {
+            Session& s = sessions[i];
+            s.fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+            if (s.fd < 0) { dropped++; continue; }
+            int one = 1;
+            setsockopt(s.fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+            if (connect(s.fd, (sockaddr*)&addr, sizeof(addr)) < 0 && errno != EINPROGRESS) {
+                close(s.fd);
+                s.fd = -1;
+                dropped++;
+                continue;
+            }
+            epoll_event ev{};
+            ev.events = EPOLLOUT;
+            ev.data.u64 = i;
+            epoll_ctl(epollFd, EPOLL_CTL_ADD, s.fd, &ev);
+            active++;
+        }
+        epoll_event events[256];
+        while (active > 0) {
+            int n = epoll_wait(epollFd, events, 256, 5000);
+            if (n == 0) {
+                cout << "No answer for 5 s, giving up on " << active << " connections.\n";
+                break;
+            }
+            for (int i = 0; i < n; i++) {
+                size_t index = events[i].data.u64;
+                Session& s = sessions[index];
+                if (s.fd < 0) continue;
+                if (!s.connected) {
+                    int error = 0;
+                    socklen_t len = sizeof(error);
+                    getsockopt(s.fd, SOL_SOCKET, SO_ERROR, &error, &len);
+                    if (error) { finish(s, false); continue; }
+                    s.connected = true;
+                    send(index, s);
+                    continue;
                 }
+                if (events[i].events & (EPOLLIN | EPOLLERR | EPOLLHUP)) readFrom(index, s);
+                else if (events[i].events & EPOLLOUT) send(index, s);
             }
-            cout << "Dish not found!\n";
         }
-        catch (string ex) { cout << ex << endl; }
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        for (Session& s : sessions) finish(s, false);
+        close(epollFd);
+
+        sort(micros.begin(), micros.end());
+        char row[200];
+        snprintf(row, sizeof(row), "Connections: %zu (%zu dropped), requests: %zu, errors: %zu\n",
+            connections, dropped, micros.size(), errors);
+        cout << row;
+        snprintf(row, sizeof(row), "Time: %.3f s, %.1f requests/sec\n", seconds, seconds > 0 ? micros.size() / seconds : 0.0);
+        cout << row;
+        snprintf(row, sizeof(row), "Latency us: p50 %.1f  p99 %.1f  p999 %.1f  max %.1f\n",
+            ScriptRunner::percentile(micros, 0.5), ScriptRunner::percentile(micros, 0.99),
+            ScriptRunner::percentile(micros, 0.999), micros.empty() ? 0.0 : micros.back());
+        cout << row;
+        return dropped ? 1 : 0;
     }
+};
+#endif
 
-    void deleteDish() {
-        if (dishes.empty()) { cout << "No dishes to delete.\n"; return; }
-        cin.ignore(numeric_limits<streamsize>::max(), '\n');
+// ==== BENCHMARKS ====
+// Built only into FinalProjectBench (FINALPROJECT_BENCH, see CMakeLists.txt).
+// Each benchmark runs in a scratch directory over synthetic data of 1K, 10K,
+// 100K and 1M records and prints one JSON result per (benchmark, size).
+// Operations that rewrite a data file on every call are sampled until the
+// time budget runs out, so "ops" can be smaller than "records".
+// Every result also reports the heap allocations per op made by the calling
+// thread; the alloc_* checks fail the run if a hot path allocates at all.
+//   FinalProjectBench [--max <records>] [--filter <text>] [--budget <seconds>] [--out <file>]
+#ifdef FINALPROJECT_BENCH
+// The bench build replaces the global operator new to count allocations per thread.
+static thread_local uint64_t heapAllocations = 0;
+
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete" // malloc/free cütü bilərəkdəndir
+#endif
+void* operator new(size_t size) {
+    heapAllocations++;
+    if (void* p = malloc(size ? size : 1)) return p;
+    throw bad_alloc();
+}
+void operator delete(void* p) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { free(p); }
+
+class BenchSuite {
+    struct Result {
         string name;
-        cout << "Enter dish name to delete: ";
-        getline(cin, name);
+        size_t records;
+        size_t ops;
+        double seconds;
+        uint64_t allocations;
+    };
 
-        for (size_t i = 0; i < dishes.size(); i++) {
-            if (dishes[i].getName() == name) {
-                dishes.erase(dishes.begin() + i);
-                saveAllData();
-                cout << "Dish deleted!\n";
-                return;
+    vector<size_t> sizes;
+    string filter;
+    double budget = 2.0;
+    vector<Result> results;
+    vector<string> allocationFailures;
+    fs::path scratch;
+    volatile size_t sink = 0; // nəticələri optimizatorun atmaması üçün
+
+    bool selected(const string& name) const {
+        return filter.empty() || name.find(filter) != string::npos;
+    }
+
+    // Lets a group skip its setup when none of its benchmarks is selected.
+    bool anySelected(initializer_list<const char*> names) const {
+        for (const char* name : names)
+            if (selected(name)) return true;
+        return false;
+    }
+
+    // Runs op(0), op(1), ... up to maxOps times or until the budget is spent.
+    // itemsPerOp > 1 reports bulk calls (e.g. a whole file load) per item.
+    template <class F>
+    void measure(const string& name, size_t records, size_t maxOps, F op, size_t itemsPerOp = 1) {
+        if (!selected(name)) return;
+        size_t ops = 0;
+        double seconds = 0;
+        uint64_t allocationsBefore = heapAllocations;
+        auto start = chrono::steady_clock::now();
+        while (ops < maxOps) {
+            op(ops++);
+            if (ops < 64 || (ops & 63) == 0) {
+                seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+                if (seconds > budget) break;
             }
         }
-        cout << "Dish not found!\n";
+        seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        ops *= itemsPerOp;
+        results.push_back({ name, records, ops, seconds, heapAllocations - allocationsBefore });
+        cerr << name << " @" << records << ": " << ops << " ops, " << seconds << " s\n";
     }
 
-    void showAllDishes() {
-        if (dishes.empty()) { cout << "Menu is empty.\n"; return; }
-        for (auto& d : dishes) {
-            cout << "-----------------------------------------------\n";
-            d.show();
-            cout << "-----------------------------------------------\n";
+    // Runs op(0..count-1) and fails the suite unless none of the calls allocated.
+    template <class F>
+    void expectNoAllocations(const string& name, size_t records, size_t count, F op) {
+        if (!selected(name)) return;
+        uint64_t allocations = 0;
+        auto start = chrono::steady_clock::now();
+        for (size_t i = 0; i < count; i++) {
+            uint64_t before = heapAllocations;
+            op(i);
+            allocations += heapAllocations - before;
         }
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        results.push_back({ name, records, count, seconds, allocations });
+        cerr << name << " @" << records << ": " << count << " ops, " << allocations << " allocations\n";
+        if (allocations) allocationFailures.push_back(name + " @" + to_string(records));
     }
 
-    void addIngredientToStock() {
-        try {
-            string name; double amount;
-            cout << "Enter ingredient name: ";
-            cin >> name;
-            cout << "Enter amount: ";
-            cin >> amount;
-            stock.addIngredient(Ingredient(name, amount));
+    // Fresh working directory: the managers read and write their files in the current directory.
+    void resetScratch() {
+        fs::current_path(scratch.parent_path());
+        fs::remove_all(scratch);
+        fs::create_directories(scratch);
+        fs::current_path(scratch);
+    }
+
+    template <class F>
+    static void writeRows(const string& path, size_t count, F row) {
+        string content;
+        for (size_t i = 0; i < count; i++) {
+            content += row(i);
+            content += '\n';
         }
-        catch (string ex) { cout << ex << endl; }
+        writeFileAtomically(path, content);
+    }
+
+    static string userRow(size_t i) {
+        char buf[200];
+        snprintf(buf, sizeof(buf), "%s_user%07zu_pass%07zu_user%07zu@gmail.com_Name_Surname_+99450%07zu_%s_%d/%d/%d",
+            ScriptRunner::generatedUserId(i).c_str(), i, i, i, i % 10000000, i % 2 ? "Female" : "Male",
+            1 + (int)(i % 28), 1 + (int)(i % 12), 1950 + (int)(i % 50));
+        return buf;
+    }
+
+    static string ingredientName(size_t i) {
+        char buf[32];
+        snprintf(buf, sizeof(buf), "ing%07zu", i);
+        return buf;
+    }
+
+    static string dishName(size_t i) {
+        char buf[32];
+        snprintf(buf, sizeof(buf), "Dish%07zu", i);
+        return buf;
     }
 
-    void showStock() {
-        try { stock.showStock(); }
-        catch (string ex) { cout << ex << endl; }
+    static string dishRow(size_t i, size_t ingredients) {
+        string row = dishName(i) + "_Benchmark dish_" + to_string(3 + i % 20);
+        for (size_t k = 0; k < 1 + i % 4; k++)
+            row += "_" + ingredientName((i * 7 + k * 13) % ingredients) + ":1.5";
+        return row;
     }
 
-    void saveAllData(string filePath = "Dishes.txt") {
-        ofstream fs(filePath);
-        if (!fs.is_open()) throw string("File cannot be opened!");
-        for (auto& d : dishes) {
-            fs << d.getName() << "_" << d.getDescription() << "_" << d.getPrice();
-            for (auto& ing : d.getIngredients())
-                fs << "_" << ing.getName() << ":" << ing.getAmount();
-            fs << "\n";
+    void benchOrderRows(size_t n) {
+        vector<Order> parsed;
+        vector<string> rows;
+        rows.reserve(n);
+        for (size_t i = 0; i < n; i++)
+            rows.push_back(Order(i + 1, ScriptRunner::generatedUserId(i % 5000), dishName(i % 50), (int)(i % 5)).toString());
+        parsed.reserve(n);
+        measure("order_fromString", n, n, [&](size_t i) { parsed.push_back(Order::fromString(rows[i])); });
+        if (parsed.size() < n) return;
+        measure("order_toString", n, n, [&](size_t i) { sink += parsed[i].toString().size(); });
+    }
+
+    void benchStock(size_t n) {
+        if (!anySelected({ "stock_lookup", "stock_addIngredient", "stock_useRecipe", "stock_addIngredient_grouped" })) return;
+        resetScratch();
+        writeRows("StorageForIngredient.txt", n, [](size_t i) { return ingredientName(i) + "_1000000"; });
+        Stock stock;
+        mt19937 rng((uint32_t)n);
+        size_t probes = min<size_t>(n, 100000);
+        vector<Dish> dishes;
+        vector<Recipe> recipes;
+        dishes.reserve(probes);
+        for (size_t i = 0; i < probes; i++) {
+            Dish d("Probe", "Lookup probe", 1);
+            d.addIngredient(Ingredient(ingredientName(rng() % n), 0.5));
+            dishes.push_back(move(d));
         }
-        fs.close();
+        recipes.reserve(probes);
+        measure("stock_lookup", n, probes, [&](size_t i) { recipes.push_back(stock.compile(dishes[i])); });
+        measure("stock_addIngredient", n, probes, [&](size_t) {
+            stock.addIngredient(Ingredient(ingredientName(rng() % n), 1));
+        });
+        if (recipes.size() >= probes)
+            measure("stock_useRecipe", n, probes, [&](size_t i) { stock.useRecipe(recipes[i], "Probe"); });
+        // Same calls with group commit; the final sync() is part of the measurement.
+        Persister persister;
+        stock.setPersister(&persister);
+        measure("stock_addIngredient_grouped", n, probes + 1, [&](size_t i) {
+            if (i < probes) stock.addIngredient(Ingredient(ingredientName(rng() % n), 1));
+            else persister.sync();
+        });
     }
 
-    void loadAllData(string filePath = "Dishes.txt") {
-        dishes.clear();
+    // Baselines: the text loaders as they were before the shared reader.
+    // Per row a stringstream split, substr + stod, and objects built through
+    // the validating setters (users with the regex validators of that time).
+    class LegacyUser {
+        string id, username, password, email, name, surname, number, card;
+        Gender gender = Male;
+        tm dataofbirth{};
+
+        static bool isValidPhoneNumber(const string& number) {
+            const regex pattern("^\\+994(50|51|55|70|77|10|99)[0-9]{7}$");
+            return regex_match(number, pattern);
+        }
+        static bool isValidEmail(const string& email) {
+            const regex pattern("^[A-Za-z0-9._%+-]+@(gmail|mail|outlook|yahoo)\\.(com|ru|az)$");
+            return regex_match(email, pattern);
+        }
+        static bool isValidId(const string& id) {
+            const regex pattern("^[A-Z0-9]{7}$");
+            return regex_match(id, pattern);
+        }
+        int getAge() const noexcept {
+            time_t now = time(nullptr);
+            tm current{};
+            tm* ptm = localtime(&now);
+            if (ptm) current = *ptm;
+            int age = (current.tm_year + 1900) - (dataofbirth.tm_year + 1900);
+            if ((current.tm_mon < dataofbirth.tm_mon) ||
+                (current.tm_mon == dataofbirth.tm_mon && current.tm_mday < dataofbirth.tm_mday))
+                age--;
+            return age;
+        }
+    public:
+        LegacyUser(string id, string username, string password, string email, string name,
+            string surname, string number, Gender gender, int day, int month, int year, string card = "") {
+            if (isValidId(id)) this->id = id;
+            else throw string("Invalid ID format!");
+            if (username.length() >= 8) this->username = username;
+            else throw string("Username must be at least 8 characters!");
+            if (password.length() >= 8) this->password = password;
+            else throw string("Password must be at least 8 characters!");
+            if (isValidEmail(email)) this->email = email;
+            else throw string("Invalid email format!");
+            if (name.length() >= 2) this->name = name;
+            else throw string("Name must be at least 2 characters!");
+            if (surname.length() >= 4) this->surname = surname;
+            else throw string("Surname must be at least 4 characters!");
+            if (year < 1900 || year > 2025) throw string("Invalid year!");
+            if (month < 1 || month > 12) throw string("Invalid month!");
+            int maxDays = 31;
+            switch (month) {
+            case 4: case 6: case 9: case 11: maxDays = 30; break;
+            case 2: maxDays = (year % 4 == 0 ? 29 : 28); break;
+            }
+            if (day < 1 || day > maxDays) throw string("Invalid day for selected month!");
+            dataofbirth.tm_mday = day;
+            dataofbirth.tm_mon = month - 1;
+            dataofbirth.tm_year = year - 1900;
+            if (getAge() < 18) throw string("User must be at least 18!");
+            this->gender = gender;
+            if (isValidPhoneNumber(number)) this->number = number;
+            else throw string("Invalid phone number format!");
+            this->card = card;
+        }
+    };
+
+    static size_t legacyLoadUsers(const string& filePath) {
+        vector<LegacyUser> users;
         ifstream fs(filePath);
-        if (!fs.is_open()) {
-            ofstream create(filePath);
-            create.close();
-            return;
+        string row;
+        while (getline(fs, row)) {
+            if (row.empty()) continue;
+            stringstream ss(row);
+            string id, username, password, email, name, surname, number, genderStr, dateStr;
+            getline(ss, id, '_');
+            getline(ss, username, '_');
+            getline(ss, password, '_');
+            getline(ss, email, '_');
+            getline(ss, name, '_');
+            getline(ss, surname, '_');
+            getline(ss, number, '_');
+            getline(ss, genderStr, '_');
+            getline(ss, dateStr);
+            int day, month, year; char slash;
+            stringstream d(dateStr);
+            d >> day >> slash >> month >> slash >> year;
+            Gender g = (genderStr == "Male" ? Male : Female);
+            try {
+                users.push_back(LegacyUser(id, username, password, email, name, surname, number, g, day, month, year));
+            }
+            catch (...) {
+                cout << "Skipped corrupted user row.\n";
+            }
         }
+        return users.size();
+    }
+
+    static size_t legacyLoadDishes(const string& filePath) {
+        vector<Dish> dishes;
+        ifstream fs(filePath);
         string row;
         while (getline(fs, row)) {
             if (row.empty()) continue;
@@ -575,297 +6035,568 @@ public:
             }
             dishes.push_back(d);
         }
+        return dishes.size();
     }
-};
-
-// ==== USER CLASS ====
-class User {
-    string id;
-    string username;
-    string password;
-    string email;
-    string name;
-    string surname;
-    string number;
-    Gender gender;
-    string card;
-    tm dataofbirth{};
-public:
-    User() {}
 
-    User(string id, string username, string password, string email, string name,
-        string surname, string number, Gender gender, int day, int month, int year, string card = "") {
-
-        setId(id);
-        setUsername(username);
-        setPassword(password);
-        setEmail(email);
-        setName(name);
-        setSurname(surname);
-        setDataOfBirth(day, month, year);
-        setGender(gender);
-        setNumber(number);
-        setCard(card);
+    static size_t legacyLoadStorage(const string& filePath) {
+        vector<Ingredient> storage;
+        ifstream fs(filePath);
+        string row;
+        while (getline(fs, row)) {
+            if (row.empty()) continue;
+            size_t pos = row.find('_');
+            if (pos != string::npos) {
+                string name = row.substr(0, pos);
+                double amount = stod(row.substr(pos + 1));
+                storage.push_back(Ingredient(name, amount));
+            }
+        }
+        return storage.size();
     }
 
-    static bool isValidPhoneNumber(const string& number) {
-        const regex pattern("^\\+994(50|51|55|70|77|10|99)[0-9]{7}$");
-        return regex_match(number, pattern);
-    }
-    static bool isValidEmail(const string& email) {
-        const regex pattern("^[A-Za-z0-9._%+-]+@(gmail|mail|outlook|yahoo)\\.(com|ru|az)$");
-        return regex_match(email, pattern);
-    }
-    static bool isValidId(const string& id) {
-        const regex pattern("^[A-Z0-9]{7}$");
-        return regex_match(id, pattern);
+    void benchLoaders(size_t n) {
+        if (!anySelected({ "admin_loadAllData", "user_loadUserData", "stock_loadStorage", "admin_loadAllData_baseline",
+            "user_loadUserData_baseline", "stock_loadStorage_baseline" })) return;
+        resetScratch();
+        writeRows("Dishes.txt", n, [n](size_t i) { return dishRow(i, n); });
+        writeRows("User.txt", n, userRow);
+        writeRows("StorageForIngredient.txt", n, [](size_t i) { return ingredientName(i) + "_" + to_string(1 + i % 500); });
+        Stock stock;
+        OrderManager orderManager(stock);
+        Admin admin(orderManager, stock);
+        UserManager userManager(orderManager);
+        measure("admin_loadAllData", n, 1, [&](size_t) { admin.loadAllData(); }, n);
+        measure("user_loadUserData", n, 1, [&](size_t) { userManager.loadUserData(); }, n);
+        measure("stock_loadStorage", n, 1, [&](size_t) { stock.loadStorage(); }, n);
+        measure("admin_loadAllData_baseline", n, 1, [&](size_t) { sink += legacyLoadDishes("Dishes.txt"); }, n);
+        measure("user_loadUserData_baseline", n, 1, [&](size_t) { sink += legacyLoadUsers("User.txt"); }, n);
+        // The old stock loader built no name index (lookups scanned the list),
+        // so the new one pays for the index here and wins on every lookup.
+        measure("stock_loadStorage_baseline", n, 1, [&](size_t) { sink += legacyLoadStorage("StorageForIngredient.txt"); }, n);
     }
 
-    void setId(string id) {
-        if (isValidId(id)) this->id = id;
-        else throw string("Invalid ID format!");
-    }
-    void setUsername(string username) {
-        if (username.length() >= 8) this->username = username;
-        else throw string("Username must be at least 8 characters!");
-    }
-    void setPassword(string password) {
-        if (password.length() >= 8) this->password = password;
-        else throw string("Password must be at least 8 characters!");
+    void benchMenu(size_t n) {
+        if (!anySelected({ "menu_show", "menu_rebuild" })) return;
+        resetScratch();
+        writeRows("StorageForIngredient.txt", n, [](size_t i) { return ingredientName(i) + "_1000"; });
+        writeRows("Dishes.txt", n, [n](size_t i) { return dishRow(i, n); });
+        Stock stock;
+        OrderManager orderManager(stock);
+        Admin admin(orderManager, stock);
+        // What a customer pays per order screen, and what a dish edit costs.
+        measure("menu_show", n, 1000, [&](size_t) { orderManager.showAllDishesWithIndex(); });
+        measure("menu_rebuild", n, 1000, [&](size_t) {
+            orderManager.compileMenu();
+            sink += orderManager.menuText(OrderManager::MenuIndexed).size();
+        });
     }
-    void setEmail(string email) {
-        if (isValidEmail(email)) this->email = email;
-        else throw string("Invalid email format!");
+
+    // Cost of one histogram sample (clock reads included), to keep the
+    // instrumentation's share of the hot paths in view.
+    void benchStats(size_t n) {
+#ifndef FINALPROJECT_NO_STATS
+        measure("stats_time_scope", n, n, [&](size_t) { STATS_TIME(StatServerRequest); });
+#else
+        (void)n;
+#endif
     }
-    void setName(string name) {
-        if (name.length() >= 2) this->name = name;
-        else throw string("Name must be at least 2 characters!");
+
+    void benchValidators(size_t n) {
+        if (!anySelected({ "user_validators", "user_validateColumn" })) return;
+        vector<string> ids, emails, phones;
+        ids.reserve(n);
+        emails.reserve(n);
+        phones.reserve(n);
+        mt19937 rng((uint32_t)n);
+        for (size_t i = 0; i < n; i++) {
+            string id = ScriptRunner::generatedUserId(i), email = "user" + to_string(i) + "@gmail.com";
+            string phone = "+99450" + to_string(1000000 + i % 9000000);
+            // Hər dördüncü dəyər bir simvolu pozulmuş halda yoxlanılır.
+            if (i % 4 == 3) {
+                id[rng() % id.size()] = '#';
+                email[rng() % email.size()] = ' ';
+                phone[rng() % phone.size()] = 'x';
+            }
+            ids.push_back(move(id));
+            emails.push_back(move(email));
+            phones.push_back(move(phone));
+        }
+        measure("user_validators", n, n, [&](size_t i) {
+            sink += User::isValidId(ids[i]) + User::isValidEmail(emails[i]) + User::isValidPhoneNumber(phones[i]);
+        }, 3);
+        vector<uint8_t> ok;
+        measure("user_validateColumn", n, 1, [&](size_t) {
+            sink += validateColumn(UserIdField, ids, ok) + validateColumn(EmailField, emails, ok)
+                + validateColumn(PhoneNumberField, phones, ok);
+        }, 3 * n);
     }
-    void setSurname(string surname) {
-        if (surname.length() >= 4) this->surname = surname;
-        else throw string("Surname must be at least 4 characters!");
+
+    void benchSignUp(size_t n) {
+        if (!anySelected({ "user_signUp_duplicate", "user_signUp", "user_signUp_grouped" })) return;
+        resetScratch();
+        writeRows("User.txt", n, userRow);
+        Stock stock;
+        OrderManager orderManager(stock);
+        UserManager userManager(orderManager);
+        mt19937 rng((uint32_t)n);
+        vector<User> probes(min<size_t>(n, 100000));
+        string error;
+        for (size_t i = 0; i < probes.size(); i++) {
+            // New ID and email, but the phone number of a random existing user.
+            UserManager::parseUserRow(userRow(n + i), probes[i], error);
+            char phone[32];
+            snprintf(phone, sizeof(phone), "+99450%07zu", (size_t)(rng() % n));
+            probes[i].setNumber(phone);
+        }
+        measure("user_signUp_duplicate", n, probes.size(), [&](size_t i) {
+            try { userManager.signUp(probes[i]); }
+            catch (const string&) { sink++; }
+        });
+        // Accepted sign-ups also append to User.txt.
+        measure("user_signUp", n, n, [&](size_t i) {
+            User u;
+            UserManager::parseUserRow(userRow(2 * n + i), u, error);
+            userManager.signUp(u);
+        });
+        Persister persister;
+        userManager.setPersister(&persister);
+        measure("user_signUp_grouped", n, n + 1, [&](size_t i) {
+            if (i == n) {
+                persister.sync();
+                return;
+            }
+            User u;
+            UserManager::parseUserRow(userRow(3 * n + i), u, error);
+            userManager.signUp(u);
+        });
     }
-    void setCard(string card) { this->card = card; }
-    void setDataOfBirth(int day, int month, int year) {
-        if (year < 1900 || year > 2025) throw string("Invalid year!");
-        if (month < 1 || month > 12) throw string("Invalid month!");
-        int maxDays = 31;
-        switch (month) {
-        case 4: case 6: case 9: case 11: maxDays = 30; break;
-        case 2: maxDays = (year % 4 == 0 ? 29 : 28); break;
+
+    // Hot paths that must not touch the heap once warmed up: advancing an order
+    // (reservation committed, journal record buffered) and deducting stock, on
+    // success and on shortage. A persister is attached, so the file writes run
+    // on its thread. This is the steady state with a pre-reserved journal
+    // buffer: it is sized for every record of the loop up front, because a
+    // growing buffer does allocate now and then.
+    void checkAllocations(size_t n) {
+        if (!anySelected({ "alloc_moveOrderForward", "alloc_stock_useRecipe", "alloc_stock_shortage" })) return;
+        resetScratch();
+        const size_t menu = 50;
+        const size_t warmUp = 256;
+        size_t count = min<size_t>(n, 20000);
+        writeRows("StorageForIngredient.txt", menu, [](size_t i) { return ingredientName(i) + "_1000000000"; });
+        writeRows("Dishes.txt", menu, [menu](size_t i) { return dishRow(i, menu); });
+        writeRows("Orders.txt", n, [menu](size_t i) {
+            return Order(i + 1, ScriptRunner::generatedUserId(i % 5000), dishName(i % menu), Received).toString();
+        });
+        Stock stock;
+        OrderManager orderManager(stock);
+        Admin admin(orderManager, stock);
+        Persister persister;
+        stock.setPersister(&persister);
+        orderManager.setPersister(&persister);
+        admin.setPersister(&persister);
+
+        for (size_t i = 0; i < warmUp * 4; i++) orderManager.moveOrderForward(i / 4 + 1);
+        persister.sync();
+        size_t advances = (min(n, count + warmUp) - warmUp) * 4;
+        orderManager.reserveJournal(advances);
+        expectNoAllocations("alloc_moveOrderForward", n, advances,
+            [&](size_t i) { orderManager.moveOrderForward(warmUp + i / 4 + 1); });
+
+        vector<Recipe> recipes;
+        string error;
+        for (size_t i = 0; i < menu; i++) {
+            Dish d;
+            Admin::parseDishRow(dishRow(i, menu), d, error);
+            recipes.push_back(stock.compile(d));
         }
-        if (day < 1 || day > maxDays)
-            throw string("Invalid day for selected month!");
-        dataofbirth.tm_mday = day;
-        dataofbirth.tm_mon = month - 1;
-        dataofbirth.tm_year = year - 1900;
-        if (getAge() < 18) throw string("User must be at least 18!");
+        Dish heavy("Heavy", "Probe", 1);
+        heavy.addIngredient(Ingredient(ingredientName(0), 1e12));
+        Recipe tooMuch = stock.compile(heavy);
+        expectNoAllocations("alloc_stock_useRecipe", n, count,
+            [&](size_t i) { sink += stock.useRecipe(recipes[i % menu], "Probe") == -1; });
+        expectNoAllocations("alloc_stock_shortage", n, count,
+            [&](size_t) { sink += stock.useRecipe(tooMuch, "Heavy") >= 0; });
+        persister.shutdown();
     }
-    void setGender(Gender g) { gender = g; }
-    void setNumber(string number) {
-        if (isValidPhoneNumber(number))
-            this->number = number;
-        else
-            throw string("Invalid phone number format!");
+
+    void benchMoveForward(size_t n) {
+        if (!anySelected({ "order_moveOrderForward", "order_query_page", "order_status_page" })) return;
+        resetScratch();
+        const size_t menu = 50;
+        writeRows("StorageForIngredient.txt", menu, [](size_t i) { return ingredientName(i) + "_1000000000"; });
+        writeRows("Dishes.txt", menu, [menu](size_t i) { return dishRow(i, menu); });
+        writeRows("Orders.txt", n, [menu](size_t i) {
+            return Order(i + 1, ScriptRunner::generatedUserId(i % 5000), dishName(i % menu), Received).toString();
+        });
+        Stock stock;
+        OrderManager orderManager(stock);
+        Admin admin(orderManager, stock);
+        mt19937 rng((uint32_t)n);
+        // A page of 20 from a random cursor, alternating unfiltered and per-user listings.
+        measure("order_query_page", n, 100000, [&](size_t i) {
+            OrderQuery query;
+            query.cursor = rng() % n;
+            if (i % 2) query.userId = ScriptRunner::generatedUserId(rng() % 5000);
+            sink += orderManager.queryOrders(query).orders.size();
+        });
+        // Each op moves one order a single step; four steps take it from Received to Ready.
+        measure("order_moveOrderForward", n, n * 4, [&](size_t i) { orderManager.moveOrderForward(i / 4 + 1); });
+        // Board refresh: all stage counts plus the first page of one active stage.
+        measure("order_status_page", n, 100000, [&](size_t i) {
+            OrderQuery query;
+            query.statusMask = OrderQuery::statusBit((OrderStatus)(i % Ready));
+            sink += orderManager.queryOrders(query).orders.size();
+            for (int st = Received; st <= Cancelled; st++) sink += orderManager.countInStatus((OrderStatus)st);
+        });
     }
-    string getId() const noexcept { return id; }
-    string getUserName() const noexcept { return username; }
-    string getPassword() const noexcept { return password; }
-    string getEmail() const noexcept { return email; }
-    string getName() const noexcept { return name; }
-    string getSurname() const noexcept { return surname; }
-    string getNumber() const noexcept { return number; }
-    string getCard() const noexcept { return card; }
-    tm getDataOfBirth() const noexcept { return dataofbirth; }
-    string getGender() const noexcept { return (gender == Male ? "Male" : "Female"); }
-    int getAge() const noexcept {
-        time_t now = time(nullptr);
-        tm current;
-        tm* ptm = localtime(&now);
-        if (ptm) current = *ptm;
-        int age = (current.tm_year + 1900) - (dataofbirth.tm_year + 1900);
-        if ((current.tm_mon < dataofbirth.tm_mon) ||
-            (current.tm_mon == dataofbirth.tm_mon && current.tm_mday < dataofbirth.tm_mday))
-            age--;
-        return age;
+
+    // Sharded kitchens: the same order stream (create, then four kitchen ticks)
+    // against 1, 2, 4 and 8 shards; ops are orders taken to Ready.
+    void benchShards(size_t n) {
+        if (!anySelected({ "shards_1", "shards_2", "shards_4", "shards_8", "shards_user_orders" })) return;
+        resetScratch();
+        const size_t menu = 50;
+        size_t count = min<size_t>(n, 200000);
+        writeRows("StorageForIngredient.txt", menu, [](size_t i) { return ingredientName(i) + "_1000000000"; });
+        writeRows("Dishes.txt", menu, [menu](size_t i) { return dishRow(i, menu); });
+        Stock stock;
+        OrderManager orderManager(stock);
+        Admin admin(orderManager, stock);
+        vector<string> users, dishes;
+        for (size_t i = 0; i < 5000; i++) users.push_back(ScriptRunner::generatedUserId(i));
+        for (size_t i = 0; i < menu; i++) dishes.push_back(dishName(i));
+        for (size_t shards : { 1, 2, 4, 8 }) {
+            string root = "kitchens" + to_string(shards) + "/";
+            KitchenShards kitchens(shards, RouteUserHash, stock, admin.getDishes(), root);
+            measure("shards_" + to_string(shards), n, 1, [&](size_t) {
+                for (size_t i = 0; i < count; i++) {
+                    kitchens.submitOrder(users[i % users.size()], dishes[i % menu]);
+                    if (i % 1024 == 1023) kitchens.tick();
+                }
+                for (int step = 0; step < kitchenStages; step++) kitchens.tick();
+                kitchens.sync();
+            }, count);
+            if (shards == 8)
+                measure("shards_user_orders", n, 1000, [&](size_t i) { sink += kitchens.ordersOfUser(users[i % users.size()]).size(); });
+        }
     }
 
-    void ShowUser() const {
-        cout << "\n----------- USER LOGIN INFO -----------\n";
-        cout << "Username: " << username << endl;
-        cout << "Password: " << password << endl;
-        cout << "Email: " << email << endl;
-        cout << "----------- USER PERSONAL INFO -----------\n";
-        cout << "ID: " << id << endl;
-        cout << "Name: " << name << endl;
-        cout << "Surname: " << surname << endl;
-        cout << "Birthday: " << dataofbirth.tm_mday << "/" << dataofbirth.tm_mon + 1 << "/" << dataofbirth.tm_year + 1900 << endl;
-        cout << "Gender: " << getGender() << endl;
-        cout << "Age: " << getAge() << endl;
+    // Order history: n orders, nine in ten finished, archived in one run;
+    // then lookups by user and by a one-minute window of creation time.
+    void benchArchive(size_t n) {
+        if (!anySelected({ "archive_write", "archive_query_user", "archive_query_range" })) return;
+        resetScratch();
+        const size_t menu = 50;
+        const uint32_t start = 1700000000;
+        writeRows("StorageForIngredient.txt", menu, [](size_t i) { return ingredientName(i) + "_1000000000"; });
+        writeRows("Dishes.txt", menu, [menu](size_t i) { return dishRow(i, menu); });
+        writeRows("Orders.txt", n, [menu, start](size_t i) {
+            return Order(i + 1, ScriptRunner::generatedUserId(i % 5000), dishName(i % menu), i % 10 ? Ready : Received, start + (uint32_t)i).toString();
+        });
+        Stock stock;
+        OrderManager orderManager(stock);
+        Admin admin(orderManager, stock);
+        size_t finished = n - (n + 9) / 10;
+        measure("archive_write", n, 1, [&](size_t) { sink += orderManager.archiveFinished(); }, finished);
+        mt19937 rng((uint32_t)n);
+        measure("archive_query_user", n, 10000, [&](size_t) {
+            ArchiveQuery query;
+            query.userId = ScriptRunner::generatedUserId(rng() % 5000);
+            query.limit = 20;
+            sink += orderManager.orderHistory(query).size();
+        });
+        measure("archive_query_range", n, 10000, [&](size_t) {
+            ArchiveQuery query;
+            query.from = start + (uint32_t)(rng() % n);
+            query.to = query.from + 59;
+            sink += orderManager.orderHistory(query).size();
+        });
     }
+public:
+    int run(int argc, char* argv[]) {
+        size_t maxRecords = 1000000;
+        string outPath;
+        for (int i = 1; i + 1 < argc; i += 2) {
+            string opt = argv[i];
+            if (opt == "--max") maxRecords = strtoull(argv[i + 1], nullptr, 10);
+            else if (opt == "--filter") filter = argv[i + 1];
+            else if (opt == "--budget") budget = strtod(argv[i + 1], nullptr);
+            else if (opt == "--out") outPath = argv[i + 1];
+            else {
+                cerr << "Unknown option: " << opt << "\n";
+                return 1;
+            }
+        }
+        for (size_t n = 1000; n <= maxRecords; n *= 10) sizes.push_back(n);
+        fs::path home = fs::current_path();
+        scratch = fs::temp_directory_path() / ("FinalProjectBench-" + to_string(random_device{}()));
+        fs::create_directories(scratch);
 
-    friend istream& operator>>(istream& in, User& right) {
-        string id, username, password, email, name, surname, number, gender_str;
-        int day, month, year;
-        cout << "ID: "; in >> id;
-        cout << "Name: "; in >> name;
-        cout << "Surname: "; in >> surname;
-        cout << "Username: "; in >> username;
-        cout << "Password: "; in >> password;
-        cout << "Email: "; in >> email;
-        cout << "Phone (+994...): "; in >> number;
-        cout << "Gender (Male/Female): "; in >> gender_str;
-        cout << "Birthday (Day Month Year): ";
-        in >> day >> month >> year;
-        Gender g;
-        if (gender_str == "Male" || gender_str == "male") g = Male;
-        else if (gender_str == "Female" || gender_str == "female") g = Female;
-        else throw string("Invalid gender!");
-        right = User(id, username, password, email, name, surname, number, g, day, month, year);
-        return in;
+        NullBuffer nullBuffer;
+        streambuf* console = cout.rdbuf(&nullBuffer);
+        try {
+            for (size_t n : sizes) {
+                benchOrderRows(n);
+                benchStock(n);
+                benchLoaders(n);
+                benchMenu(n);
+                benchValidators(n);
+                benchStats(n);
+                benchSignUp(n);
+                benchMoveForward(n);
+                benchShards(n);
+                benchArchive(n);
+                checkAllocations(n);
+            }
+        }
+        catch (const string& ex) {
+            cout.rdbuf(console);
+            cerr << "Benchmark failed: " << ex << "\n";
+            fs::current_path(home);
+            fs::remove_all(scratch);
+            return 1;
+        }
+        cout.rdbuf(console);
+        fs::current_path(home);
+        fs::remove_all(scratch);
+
+        ostringstream json;
+        json << "{\n  \"suite\": \"FinalProjectBench\",\n  \"budget_seconds\": " << budget << ",\n  \"results\": [";
+        for (size_t i = 0; i < results.size(); i++) {
+            const Result& r = results[i];
+            char row[256];
+            snprintf(row, sizeof(row),
+                "%s\n    {\"name\": \"%s\", \"records\": %zu, \"ops\": %zu, \"seconds\": %.6f, \"ns_per_op\": %.1f, \"ops_per_sec\": %.1f, \"allocs_per_op\": %.2f}",
+                i ? "," : "", r.name.c_str(), r.records, r.ops, r.seconds,
+                r.ops ? r.seconds * 1e9 / r.ops : 0.0, r.seconds > 0 ? r.ops / r.seconds : 0.0,
+                r.ops ? (double)r.allocations / r.ops : 0.0);
+            json << row;
+        }
+        json << "\n  ]\n}\n";
+        if (outPath.empty()) cout << json.str();
+        else writeFileAtomically(outPath, json.str());
+        for (const string& failure : allocationFailures)
+            cerr << "Allocation check failed: " << failure << "\n";
+        return allocationFailures.empty() ? 0 : 1;
     }
 };
+#endif
 
-class UserManager {
-    vector<User> users;
-    OrderManager& orderManager;
-    string currentUserId;
-    Admin* adminPtr = nullptr;
+// ==== STATS DUMP ====
+// Rewrites a file with Stats::report() every `interval`, and once more when stopped.
+class StatsDumper {
+    string path;
+    chrono::seconds interval;
+    mutex m;
+    condition_variable wake;
+    bool stopping = false;
+    thread worker;
+
+    void dump() {
+        char stamp[64] = "unknown time";
+        tm local{};
+        if (toLocalTime(time(nullptr), local)) strftime(stamp, sizeof(stamp), "%Y-%m-%d %H:%M:%S", &local);
+        try { replaceFile(path, string("# ") + stamp + "\n" + Stats::report()); }
+        catch (const string&) {} // növbəti dəfə yenə cəhd edilir
+    }
 public:
-    UserManager(OrderManager& om) : orderManager(om) {
-        loadUserData(users);
+    StatsDumper(string path, chrono::seconds interval) : path(move(path)), interval(interval) {
+        worker = thread([this] {
+            unique_lock<mutex> lock(m);
+            while (!wake.wait_for(lock, this->interval, [this] { return stopping; })) {
+                lock.unlock();
+                dump();
+                lock.lock();
+            }
+        });
     }
-
-    void setAdmin(Admin* admin) {
-        adminPtr = admin;
+    StatsDumper(const StatsDumper&) = delete;
+    StatsDumper& operator=(const StatsDumper&) = delete;
+    ~StatsDumper() {
+        {
+            lock_guard<mutex> lock(m);
+            stopping = true;
+        }
+        wake.notify_one();
+        worker.join();
+        dump();
     }
+};
 
-    void UserPanel() {
-        int choice;
-        do {
-            cout << "\n=== USER PANEL ===\n";
-            cout << "1. Create Order\n";
-            cout << "2. View Order Status\n";
-            cout << "3. View Profile\n";
-            cout << "0. Exit\n";
-            cout << "Choice: ";
-            cin >> choice;
-            if (choice == 1) {
-                if (orderManager.getDishCount() == 0) { cout << "Menu is empty.\n"; continue; }
-                orderManager.showAllDishesWithIndex();
-                int idx;
-                cout << "Enter dish index: ";
-                cin >> idx;
-                try {
-                    string dishName = orderManager.getDishNameByIndex(idx);
-                    orderManager.createOrder(currentUserId, dishName);
-                    cout << "Order created!\n";
-                }
-                catch (string ex) { cout << ex << endl; }
-            }
-            else if (choice == 2) {
-                orderManager.showMyOrderStatus(currentUserId);
-            }
-            else if (choice == 3) {
-                for (auto& u : users)
-                    if (u.getId() == currentUserId)
-                        u.ShowUser();
+// ==== MAIN ====
+int main(int argc, char* argv[]) {
+#ifdef FINALPROJECT_BENCH
+    // The bench target has no interactive program.
+    BenchSuite bench;
+    return bench.run(argc, argv);
+#else
+    // Persistence options come before the mode: [--fsync] [--flush-window <ms>]
+    // [--stats-interval <s>] (Stats.txt dump, 0 = off) and, for --script only,
+    // [--kitchens <n>] [--route user|least|stock].
+    PersistConfig persistConfig;
+    unsigned long statsInterval = 60;
+    size_t kitchenCount = 0;
+    RoutePolicy route = RouteUserHash;
+    int first = 1;
+    for (; first < argc; first++) {
+        string opt = argv[first];
+        if (opt == "--fsync") persistConfig.fsync = true;
+        else if (opt == "--flush-window" && first + 1 < argc)
+            persistConfig.window = chrono::milliseconds(strtoul(argv[++first], nullptr, 10));
+        else if (opt == "--stats-interval" && first + 1 < argc)
+            statsInterval = strtoul(argv[++first], nullptr, 10);
+        else if (opt == "--kitchens" && first + 1 < argc)
+            kitchenCount = strtoul(argv[++first], nullptr, 10);
+        else if (opt == "--route" && first + 1 < argc) {
+            if (!KitchenShards::parsePolicy(argv[++first], route)) {
+                cout << "Unknown route: " << argv[first] << " (user, least or stock)\n";
+                return 1;
             }
-        } while (choice != 0);
+        }
+        else break;
     }
+    argv[first - 1] = argv[0];
+    argv += first - 1;
+    argc -= first - 1;
 
-    void signUp(const User& user) {
-        for (auto& u : users) {
-            if (u.getId() == user.getId()) throw string("ID already exists!");
-            if (u.getEmail() == user.getEmail()) throw string("Email already exists!");
-            if (u.getNumber() == user.getNumber()) throw string("Phone number already exists!");
+    string mode = argc > 1 ? argv[1] : "";
+    if (mode == "--verify-validators") {
+        size_t cases = argc > 2 ? strtoul(argv[2], nullptr, 10) : 200000;
+        return verifyValidators(cases) == 0 ? 0 : 1;
+    }
+    if (mode == "--convert") {
+        // to-binary: writes the .bin snapshots next to the text files; from then on
+        //            the .bin files are used.
+        // to-text:   writes the text files from the .bin snapshots and removes them.
+        string target = argc > 2 ? argv[2] : "";
+        if (target != "to-binary" && target != "to-text") {
+            cout << "Usage: " << argv[0] << " --convert to-binary|to-text\n";
+            return 1;
         }
-        users.push_back(user);
-        saveUserData(users);
-        cout << "User registered!\n";
+        bool binary = target == "to-binary";
+        try {
+            Stock stock;
+            OrderManager orderManager(stock);
+            Admin admin(orderManager, stock);
+            UserManager userManager(orderManager);
+            stock.setBinarySnapshot(binary);
+            orderManager.setBinarySnapshot(binary);
+            admin.setBinarySnapshot(binary);
+            userManager.setBinarySnapshot(binary);
+        }
+        catch (const string& ex) {
+            cout << ex << endl;
+            return 1;
+        }
+        cout << "Data files converted " << (binary ? "to binary snapshots" : "to text") << ".\n";
+        return 0;
     }
 
-    void signIn(const string& username, const string& password) {
-        string uname = username, pass = password;
-        for (auto& c : uname) c = tolower(c);
-        for (auto& c : pass) c = tolower(c);
-        if (uname == "admin" && pass == "admin") {
-            cout << "Logged in as Admin.\n";
-            if (adminPtr) adminPtr->AdminPanel();
-            else cout << "Admin instance not attached!\n";
-            return;
-        }
-        for (auto& u : users) {
-            if (u.getUserName() == username && u.getPassword() == password) {
-                currentUserId = u.getId();
-                cout << "Login successful!\n";
-                UserPanel();
-                return;
-            }
+    if (mode == "--load") {
+#ifdef __linux__
+        if (argc < 7) {
+            cout << "Usage: " << argv[0] << " --load <port> <connections> <requests per connection> <username> <password>\n";
+            return 1;
         }
-        cout << "Wrong username or password!\n";
+        LoadClient client((uint16_t)strtoul(argv[2], nullptr, 10), strtoull(argv[4], nullptr, 10), argv[5], argv[6]);
+        return client.run(strtoull(argv[3], nullptr, 10));
+#else
+        cout << "The load client needs Linux (epoll).\n";
+        return 1;
+#endif
     }
 
-    void saveUserData(const vector<User>& users) {
-        ofstream fs("User.txt");
-        if (!fs.is_open()) throw string("Cannot open User.txt!");
-        for (auto& u : users) {
-            fs << u.getId() << "_"
-                << u.getUserName() << "_"
-                << u.getPassword() << "_"
-                << u.getEmail() << "_"
-                << u.getName() << "_"
-                << u.getSurname() << "_"
-                << u.getNumber() << "_"
-                << u.getGender() << "_"
-                << u.getDataOfBirth().tm_mday << "/"
-                << u.getDataOfBirth().tm_mon + 1 << "/"
-                << u.getDataOfBirth().tm_year + 1900 << "\n";
-        }
-        fs.close();
-    }
-
-    void loadUserData(vector<User>& users) {
-        ifstream fs("User.txt");
-        if (!fs.is_open()) {
-            ofstream create("User.txt");
-            create.close();
-            return;
+    if (mode == "--generate") {
+        if (argc < 7) {
+            cout << "Usage: " << argv[0] << " --generate <seed> <users> <dishes> <orders> <out-file>\n";
+            return 1;
         }
-        string row;
-        while (getline(fs, row)) {
-            if (row.empty()) continue;
-            stringstream ss(row);
-            string id, username, password, email, name, surname, number, genderStr, dateStr;
-            getline(ss, id, '_');
-            getline(ss, username, '_');
-            getline(ss, password, '_');
-            getline(ss, email, '_');
-            getline(ss, name, '_');
-            getline(ss, surname, '_');
-            getline(ss, number, '_');
-            getline(ss, genderStr, '_');
-            getline(ss, dateStr);
-            int day, month, year; char slash;
-            stringstream d(dateStr);
-            d >> day >> slash >> month >> slash >> year;
-            Gender g = (genderStr == "Male" ? Male : Female);
-            try {
-                users.push_back(User(id, username, password, email, name, surname, number, g, day, month, year));
-            }
-            catch (...) {
-                cout << "Skipped corrupted user row.\n";
-            }
+        bool ok;
+        try {
+            ok = ScriptRunner::generate((uint32_t)strtoul(argv[2], nullptr, 10), strtoull(argv[3], nullptr, 10),
+                strtoull(argv[4], nullptr, 10), strtoull(argv[5], nullptr, 10), argv[6]);
         }
+        catch (const string& ex) {
+            cout << ex << endl;
+            return 1;
+        }
+        if (!ok) cout << "Cannot write " << argv[6] << "\n";
+        return ok ? 0 : 1;
     }
-};
 
-// ==== MAIN ====
-int main() {
-    OrderManager orderManager;
-    Admin admin(orderManager);
+    Stock stock;
+    OrderManager orderManager(stock);
+    Admin admin(orderManager, stock);
     UserManager userManager(orderManager);
     userManager.setAdmin(&admin);
+    // Declared after the stores so that it stops before they are destroyed.
+    // Stock goes first: a round writes its file before the order journal.
+    Persister persister(persistConfig);
+    stock.setPersister(&persister);
+    orderManager.setPersister(&persister);
+    admin.setPersister(&persister);
+    userManager.setPersister(&persister);
+    unique_ptr<StatsDumper> statsDumper;
+    if (Stats::enabled && statsInterval > 0)
+        statsDumper = make_unique<StatsDumper>("Stats.txt", chrono::seconds(statsInterval));
+    auto shutdown = [&]() {
+        try {
+            persister.shutdown();
+            orderManager.checkpoint();
+            return true;
+        }
+        catch (const string& ex) {
+            cout << ex << endl;
+            return false;
+        }
+    };
+
+    if (mode == "--script") {
+        if (argc < 3) {
+            cout << "Usage: " << argv[0] << " --script <file|->\n";
+            return 1;
+        }
+        ScriptRunner runner(stock, orderManager, admin, userManager, &persister);
+        if (!kitchenCount) {
+            int code = runner.run(argv[2]);
+            return shutdown() ? code : 1;
+        }
+        int code;
+        try {
+            KitchenShards kitchens(kitchenCount, route, stock, admin.getDishes(), "kitchens/", persistConfig);
+            runner.setKitchens(&kitchens);
+            code = runner.run(argv[2]);
+            kitchens.showSummary();
+        }
+        catch (const string& ex) {
+            cout << ex << endl;
+            code = 1;
+        }
+        return shutdown() ? code : 1;
+    }
+    if (kitchenCount) {
+        cout << "--kitchens is only used with --script.\n";
+        return 1;
+    }
+
+    if (mode == "--serve") {
+#ifdef __linux__
+        if (argc < 3) {
+            cout << "Usage: " << argv[0] << " --serve <port>\n";
+            return 1;
+        }
+        int code;
+        {
+            OrderServer server(orderManager, userManager, admin);
+            code = server.run((uint16_t)strtoul(argv[2], nullptr, 10));
+        }
+        return shutdown() ? code : 1;
+#else
+        cout << "The order server needs Linux (epoll).\n";
+        return 1;
+#endif
+    }
 
     while (true) {
         string choiceStr;
@@ -894,11 +6625,12 @@ int main() {
         }
         else if (choice == 0) {
             cout << "Exiting program...\n";
-            break;
+            return shutdown() ? 0 : 1;
         }
         else {
             cout << "Invalid choice!\n";
         }
     }
     return 0;
+#endif
 }
\ No newline at end of file